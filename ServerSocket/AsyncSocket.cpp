@@ -0,0 +1,88 @@
+// Implementation of the AsyncSocket class
+
+#include "AsyncSocket.h"
+#include <errno.h>
+
+
+static bool would_block()
+{
+  return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+
+AsyncSocket::AsyncSocket ( Executor& exec, ServerSocket&& sock ) :
+  m_exec ( exec ),
+  m_sock ( std::move ( sock ) )
+{
+  m_sock.set_non_blocking ( true );
+}
+
+AsyncSocket::~AsyncSocket()
+{
+  m_exec.forget ( fd() );
+}
+
+
+bool AsyncSocket::AcceptAwaiter::attempt()
+{
+  while ( true )
+    {
+      SocketResult<ServerSocket> r = m_socket.m_sock.try_accept ( true );
+
+      if ( r )
+	{
+	  m_result = std::move ( *r );
+	  m_accepted = true;
+	  return true;
+	}
+
+      if ( accept_retry_now ( r.error() ) )
+	continue;
+
+      if ( r.error() == EAGAIN || r.error() == EWOULDBLOCK )
+	return false;
+
+      // Completes with the error; retrying here would spin.
+      m_error = r.error();
+      return true;
+    }
+}
+
+
+SocketResult<std::unique_ptr<AsyncSocket> > AsyncSocket::AcceptAwaiter::await_resume()
+{
+  if ( ! m_accepted )
+    return SocketError ( m_error );
+
+  return std::unique_ptr<AsyncSocket> ( new AsyncSocket ( m_socket.m_exec, std::move ( m_result ) ) );
+}
+
+
+bool AsyncSocket::RecvAwaiter::attempt()
+{
+  m_result = m_socket.m_sock.read_some ( m_buf.data(), m_buf.size() );
+
+  return m_result != -1 || ! would_block();
+}
+
+
+bool AsyncSocket::SendAwaiter::attempt()
+{
+  while ( ! m_data.empty() )
+    {
+      ssize_t n = m_socket.m_sock.write_some ( m_data.data(), m_data.size() );
+
+      if ( n == -1 )
+	{
+	  if ( would_block() )
+	    return false;
+
+	  m_ok = false;
+	  return true;
+	}
+
+      m_data.remove_prefix ( n );
+    }
+
+  return true;
+}
@@ -0,0 +1,98 @@
+// Definition of the AsyncSocket class
+
+#ifndef AsyncSocket_class
+#define AsyncSocket_class
+
+#include "ServerSocket.h"
+#include "Executor.h"
+#include <memory>
+#include <span>
+#include <string_view>
+
+
+// A non-blocking ServerSocket whose operations are awaited from a Task:
+//
+//   SocketResult<std::unique_ptr<AsyncSocket> > r = co_await listener.async_accept();
+//   std::unique_ptr<AsyncSocket> conn = std::move ( *r );
+//   ssize_t n = co_await conn->async_recv ( buf );
+//   bool ok = co_await conn->async_send ( reply );
+//
+// Each operation completes at once when it can, and otherwise suspends
+// the coroutine until the Executor sees the socket ready.
+class AsyncSocket
+{
+ public:
+
+  AsyncSocket ( Executor&, ServerSocket&& );
+  virtual ~AsyncSocket();
+
+  class AcceptAwaiter : public IoAwaiter
+  {
+   public:
+    AcceptAwaiter ( AsyncSocket& s ) : m_socket ( s ), m_accepted ( false ), m_error ( 0 ) {};
+    bool attempt();
+    bool await_ready() { return attempt(); }
+    void await_suspend ( std::coroutine_handle<> h ) { m_handle = h; m_socket.m_exec.wait ( m_socket.fd(), false, this ); }
+    SocketResult<std::unique_ptr<AsyncSocket> > await_resume();
+   private:
+    AsyncSocket& m_socket;
+    ServerSocket m_result;
+    bool m_accepted;
+    int m_error;
+  };
+
+  class RecvAwaiter : public IoAwaiter
+  {
+   public:
+    RecvAwaiter ( AsyncSocket& s, std::span<char> buf ) : m_socket ( s ), m_buf ( buf ), m_result ( 0 ) {};
+    bool attempt();
+    bool await_ready() { return attempt(); }
+    void await_suspend ( std::coroutine_handle<> h ) { m_handle = h; m_socket.m_exec.wait ( m_socket.fd(), false, this ); }
+    ssize_t await_resume() { return m_result; }
+   private:
+    AsyncSocket& m_socket;
+    std::span<char> m_buf;
+    ssize_t m_result;
+  };
+
+  class SendAwaiter : public IoAwaiter
+  {
+   public:
+    SendAwaiter ( AsyncSocket& s, std::string_view data ) : m_socket ( s ), m_data ( data ), m_ok ( true ) {};
+    bool attempt();
+    bool await_ready() { return attempt(); }
+    void await_suspend ( std::coroutine_handle<> h ) { m_handle = h; m_socket.m_exec.wait ( m_socket.fd(), true, this ); }
+    bool await_resume() { return m_ok; }
+   private:
+    AsyncSocket& m_socket;
+    std::string_view m_data;   // the part not sent yet
+    bool m_ok;
+  };
+
+  // Yields the new connection, or the errno if accept failed. Out of
+  // descriptors or memory the listener stays readable, so back off before
+  // accepting again, e.g. co_await executor().sleep ( ACCEPT_BACKOFF_MS ).
+  AcceptAwaiter async_accept() { return AcceptAwaiter ( *this ); }
+
+  // Yields the byte count, 0 on orderly shutdown or -1 on error.
+  RecvAwaiter async_recv ( std::span<char> buf ) { return RecvAwaiter ( *this, buf ); }
+
+  // Yields true once every byte is sent, false on error. The data must
+  // stay valid until the send completes.
+  SendAwaiter async_send ( std::string_view data ) { return SendAwaiter ( *this, data ); }
+
+  int fd() const { return m_sock.fd(); }
+  Executor& executor() { return m_exec; }
+
+ private:
+
+  AsyncSocket ( const AsyncSocket& );
+  AsyncSocket& operator = ( const AsyncSocket& );
+
+  Executor& m_exec;
+  ServerSocket m_sock;
+
+};
+
+
+#endif
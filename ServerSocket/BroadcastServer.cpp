@@ -0,0 +1,261 @@
+// Implementation of the BroadcastServer class
+
+#include "BroadcastServer.h"
+#include <algorithm>
+
+
+BroadcastServer::Subscriber::~Subscriber()
+{
+  for ( auto& l : latest )
+    l.second->unref();
+}
+
+
+BroadcastServer::BroadcastServer ( ServerSocket& listener, SlowPolicy policy ) :
+  m_reactor ( listener, [this] ( Connection& c, std::string_view data ) { on_data ( c, data ); } ),
+  m_policy ( policy ),
+  m_shared ( true )
+{
+  m_stats.published = m_stats.delivered = m_stats.dropped = m_stats.conflated = 0;
+
+  m_reactor.on_close ( [this] ( Connection& c ) { on_close ( c ); } );
+  m_reactor.on_drain ( [this] ( Connection& c ) { on_drain ( c ); } );
+}
+
+
+size_t BroadcastServer::subscribers ( std::string_view topic ) const
+{
+  auto it = m_topics.find ( topic );
+
+  return it == m_topics.end() ? 0 : it->second.size();
+}
+
+
+size_t BroadcastServer::publish ( std::string_view topic, std::string_view payload )
+{
+  m_stats.published++;
+
+  auto it = m_topics.find ( topic );
+
+  if ( it == m_topics.end() )
+    return 0;
+
+  SharedBuffer* b = SharedBuffer::create ( { topic, " ", payload, "\n" } );
+  size_t n = 0;
+
+  for ( Connection* c : it->second )
+    if ( deliver ( *c, b, it->first ) )
+      n++;
+
+  b->unref();
+
+  // Dropped subscribers leave their topics only now, once the list is no
+  // longer being walked.
+  for ( Connection* c : m_slow )
+    {
+      Subscriber* s = m_subs.get ( c->fd() );
+
+      while ( s && ! s->topics.empty() )
+	unsubscribe ( *c, *s, std::string ( s->topics.back() ) );
+
+      c->abort();
+      m_stats.dropped++;
+    }
+
+  m_slow.clear();
+
+  return n;
+}
+
+
+bool BroadcastServer::deliver ( Connection& c, SharedBuffer* b, std::string_view topic )
+{
+  if ( c.backlogged() )
+    {
+      if ( m_policy == SLOW_DROP )
+	{
+	  m_slow.push_back ( &c );
+	  return false;
+	}
+
+      // Held back until the queue drains; a newer message replaces it.
+      Subscriber* s = m_subs.get ( c.fd() );
+      auto it = s->latest.find ( topic );
+
+      b->ref();
+
+      if ( it == s->latest.end() )
+	s->latest.emplace ( std::string ( topic ), b );
+      else
+	{
+	  it->second->unref();
+	  it->second = b;
+	  m_stats.conflated++;
+	}
+
+      return false;
+    }
+
+  if ( m_shared )
+    c.send ( b );
+  else
+    c.send ( b->view() );
+
+  m_stats.delivered++;
+
+  return true;
+}
+
+
+void BroadcastServer::on_drain ( Connection& c )
+{
+  Subscriber* s = m_subs.get ( c.fd() );
+
+  if ( ! s )
+    return;
+
+  for ( auto& l : s->latest )
+    {
+      c.send ( l.second );
+      l.second->unref();
+      m_stats.delivered++;
+    }
+
+  s->latest.clear();
+}
+
+
+void BroadcastServer::on_close ( Connection& c )
+{
+  Subscriber* s = m_subs.get ( c.fd() );
+
+  if ( ! s )
+    return;
+
+  while ( ! s->topics.empty() )
+    unsubscribe ( c, *s, std::string ( s->topics.back() ) );
+
+  m_subs.destroy ( c.fd() );
+}
+
+
+void BroadcastServer::on_data ( Connection& c, std::string_view data )
+{
+  Subscriber* s = m_subs.get ( c.fd() );
+
+  if ( ! s )
+    s = m_subs.create ( c.fd() );
+
+  // Whole lines are handled where the reactor read them; only a partial
+  // one at the end is copied, to wait for the rest.
+  std::string_view buf = data;
+
+  if ( ! s->partial.empty() )
+    {
+      s->partial.append ( data );
+      buf = s->partial;
+    }
+
+  size_t pos = 0;
+  size_t eol;
+
+  while ( ( eol = buf.find ( '\n', pos ) ) != std::string_view::npos )
+    {
+      command ( c, *s, buf.substr ( pos, eol - pos ) );
+      pos = eol + 1;
+    }
+
+  if ( buf.size() - pos > BROADCAST_MAX_LINE )
+    {
+      c.close();
+      return;
+    }
+
+  if ( s->partial.empty() )
+    s->partial.assign ( buf.substr ( pos ) );
+  else
+    s->partial.erase ( 0, pos );
+}
+
+
+void BroadcastServer::command ( Connection& c, Subscriber& s, std::string_view line )
+{
+  if ( ! line.empty() && line.back() == '\r' )
+    line.remove_suffix ( 1 );
+
+  size_t sp = line.find ( ' ' );
+
+  if ( sp == std::string_view::npos )
+    return;
+
+  std::string_view verb = line.substr ( 0, sp );
+  std::string_view rest = line.substr ( sp + 1 );
+
+  if ( verb == "PUB" )
+    {
+      sp = rest.find ( ' ' );
+      std::string_view topic = rest.substr ( 0, sp );
+
+      if ( ! topic.empty() )
+	publish ( topic, sp == std::string_view::npos ? std::string_view() : rest.substr ( sp + 1 ) );
+    }
+  else if ( rest.empty() || rest.find ( ' ' ) != std::string_view::npos )
+    return;
+  else if ( verb == "SUB" )
+    subscribe ( c, s, rest );
+  else if ( verb == "UNSUB" )
+    unsubscribe ( c, s, rest );
+}
+
+
+void BroadcastServer::subscribe ( Connection& c, Subscriber& s, std::string_view topic )
+{
+  if ( std::find ( s.topics.begin(), s.topics.end(), topic ) != s.topics.end() )
+    return;
+
+  s.topics.push_back ( std::string ( topic ) );
+
+  auto it = m_topics.find ( topic );
+
+  if ( it == m_topics.end() )
+    it = m_topics.emplace ( std::string ( topic ), std::vector<Connection*>() ).first;
+
+  it->second.push_back ( &c );
+}
+
+
+void BroadcastServer::unsubscribe ( Connection& c, Subscriber& s, std::string_view topic )
+{
+  auto t = std::find ( s.topics.begin(), s.topics.end(), topic );
+
+  if ( t == s.topics.end() )
+    return;
+
+  s.topics.erase ( t );
+
+  auto it = m_topics.find ( topic );
+
+  if ( it == m_topics.end() )
+    return;
+
+  std::vector<Connection*>& subs = it->second;
+  auto i = std::find ( subs.begin(), subs.end(), &c );
+
+  if ( i != subs.end() )
+    {
+      *i = subs.back();
+      subs.pop_back();
+    }
+
+  if ( subs.empty() )
+    m_topics.erase ( it );
+
+  // A conflated message for a topic no longer wanted is not sent.
+  auto l = s.latest.find ( topic );
+
+  if ( l != s.latest.end() )
+    {
+      l->second->unref();
+      s.latest.erase ( l );
+    }
+}
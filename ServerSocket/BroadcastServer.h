@@ -0,0 +1,102 @@
+// Definition of the BroadcastServer class
+
+#ifndef BroadcastServer_class
+#define BroadcastServer_class
+
+#include "ReactorServer.h"
+#include "SharedBuffer.h"
+#include "Slab.h"
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+const size_t BROADCAST_MAX_LINE = 64 * 1024;
+
+// What to do with a subscriber whose write queue is above the high
+// watermark when a message for it is published.
+enum SlowPolicy
+  {
+    SLOW_DROP,        // disconnect it
+    SLOW_CONFLATE     // keep only the newest message per topic until it drains
+  };
+
+struct BroadcastStats
+{
+  uint64_t published;
+  uint64_t delivered;   // messages queued on a subscriber
+  uint64_t dropped;     // subscribers disconnected for being slow
+  uint64_t conflated;   // messages replaced by a newer one before sending
+};
+
+// Topic based fan-out on a ReactorServer. Clients send lines:
+//
+//   SUB topic
+//   UNSUB topic
+//   PUB topic payload
+//
+// and every subscriber of the topic receives "topic payload\n". Each
+// message is encoded once into a SharedBuffer, and every subscriber's
+// write queue takes a reference to it, so a message for ten thousand
+// subscribers is still one allocation and one copy. Slow subscribers are
+// dealt with by the SlowPolicy; the watermarks deciding who is slow are
+// the reactor's.
+class BroadcastServer
+{
+ public:
+
+  BroadcastServer ( ServerSocket& listener, SlowPolicy policy = SLOW_DROP );
+  virtual ~BroadcastServer() {};
+
+  // Loop thread only. Returns the number of subscribers it was queued on.
+  size_t publish ( std::string_view topic, std::string_view payload );
+
+  // false copies each message into every queue instead, as a loop of
+  // send calls would; for comparison.
+  void set_shared ( bool shared ) { m_shared = shared; }
+
+  void run() { m_reactor.run(); }
+  void stop() { m_reactor.stop(); }
+
+  size_t subscribers ( std::string_view topic ) const;
+  const BroadcastStats& stats() const { return m_stats; }
+  ReactorServer& reactor() { return m_reactor; }
+
+ private:
+
+  BroadcastServer ( const BroadcastServer& );
+  BroadcastServer& operator = ( const BroadcastServer& );
+
+  typedef ReactorServer::Connection Connection;
+
+  struct Subscriber
+  {
+    std::string partial;                 // a line split across reads
+    std::vector<std::string> topics;
+    std::map<std::string, SharedBuffer*, std::less<> > latest;   // conflated, not yet queued
+    ~Subscriber();
+  };
+
+  void on_data ( Connection&, std::string_view );
+  void on_close ( Connection& );
+  void on_drain ( Connection& );
+  void command ( Connection&, Subscriber&, std::string_view line );
+
+  void subscribe ( Connection&, Subscriber&, std::string_view topic );
+  void unsubscribe ( Connection&, Subscriber&, std::string_view topic );
+  bool deliver ( Connection&, SharedBuffer*, std::string_view topic );
+
+  ReactorServer m_reactor;
+  SlowPolicy m_policy;
+  bool m_shared;
+  Slab<Subscriber> m_subs;
+  std::map<std::string, std::vector<Connection*>, std::less<> > m_topics;
+  std::vector<Connection*> m_slow;
+  BroadcastStats m_stats;
+
+};
+
+
+#endif
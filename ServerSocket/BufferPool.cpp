@@ -0,0 +1,64 @@
+// Implementation of the BufferPool class
+
+#include "BufferPool.h"
+#include <stdlib.h>
+#include <new>
+
+
+BufferPool::BufferPool ( size_t buffer_size, size_t max_free ) :
+  m_buffer_size ( ( buffer_size + CACHE_LINE - 1 ) / CACHE_LINE * CACHE_LINE ),
+  m_max_free ( max_free ),
+  m_free ( 0 ),
+  m_free_count ( 0 ),
+  m_allocations ( 0 )
+{
+}
+
+BufferPool::~BufferPool()
+{
+  while ( m_free )
+    {
+      Node* n = m_free;
+      m_free = n->next;
+      ::free ( n );
+    }
+}
+
+
+char* BufferPool::acquire()
+{
+  if ( m_free )
+    {
+      Node* n = m_free;
+      m_free = n->next;
+      m_free_count--;
+      return reinterpret_cast<char*> ( n );
+    }
+
+  void* p = ::aligned_alloc ( CACHE_LINE, m_buffer_size );
+
+  if ( ! p )
+    throw std::bad_alloc();
+
+  m_allocations++;
+
+  return static_cast<char*> ( p );
+}
+
+
+void BufferPool::release ( char* p )
+{
+  if ( ! p )
+    return;
+
+  if ( m_free_count >= m_max_free )
+    {
+      ::free ( p );
+      return;
+    }
+
+  Node* n = reinterpret_cast<Node*> ( p );
+  n->next = m_free;
+  m_free = n;
+  m_free_count++;
+}
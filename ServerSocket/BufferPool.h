@@ -0,0 +1,52 @@
+// Definition of the BufferPool class
+
+#ifndef BufferPool_class
+#define BufferPool_class
+
+#include "Slab.h"
+#include <stddef.h>
+
+
+const size_t POOL_MAX_FREE = 1024;
+
+// Fixed-size I/O buffers, cache-line aligned, recycled through an
+// intrusive free list: acquire and release are O(1) and touch malloc
+// only while the pool is still warming up. Up to max_free released
+// buffers are kept; beyond that they go back to the allocator, so one
+// burst does not pin its peak forever. Not thread-safe - one per loop.
+class BufferPool
+{
+ public:
+
+  BufferPool ( size_t buffer_size, size_t max_free = POOL_MAX_FREE );
+  virtual ~BufferPool();
+
+  char* acquire();
+  void release ( char* );
+
+  size_t buffer_size() const { return m_buffer_size; }
+  size_t free_buffers() const { return m_free_count; }
+
+  // Buffers handed out that malloc had to provide.
+  size_t allocations() const { return m_allocations; }
+
+ private:
+
+  BufferPool ( const BufferPool& );
+  BufferPool& operator = ( const BufferPool& );
+
+  struct Node
+  {
+    Node* next;
+  };
+
+  size_t m_buffer_size;
+  size_t m_max_free;
+  Node* m_free;
+  size_t m_free_count;
+  size_t m_allocations;
+
+};
+
+
+#endif
@@ -6,24 +6,62 @@
 
 ClientSocket::ClientSocket ( std::string host, int port )
 {
-  if ( ! Socket::create() )
+  SocketResult<void> r = Socket::create();
+  if ( ! r )
     {
-      throw SocketException ( "Could not create client socket." );
+      throw SocketException ( "Could not create client socket.", r.error() );
     }
 
-  if ( ! Socket::connect ( host, port ) )
+  if ( ! ( r = Socket::connect ( host, port ) ) )
     {
-      throw SocketException ( "Could not bind to port." );
+      throw SocketException ( "Could not bind to port.", r.error() );
     }
 
 }
 
 
+ClientSocket::ClientSocket ( const std::string& path )
+{
+  SocketResult<void> r = Socket::create_local();
+  if ( ! r )
+    {
+      throw SocketException ( "Could not create client socket.", r.error() );
+    }
+
+  if ( ! ( r = Socket::connect_local ( path ) ) )
+    {
+      throw SocketException ( "Could not connect to path.", r.error() );
+    }
+
+}
+
+
+SocketResult<void> ClientSocket::try_connect ( std::string host, int port )
+{
+  SocketResult<void> r = Socket::create();
+  if ( ! r )
+    return r;
+
+  return Socket::connect ( host, port );
+}
+
+
+SocketResult<void> ClientSocket::try_connect_local ( const std::string& path )
+{
+  SocketResult<void> r = Socket::create_local();
+  if ( ! r )
+    return r;
+
+  return Socket::connect_local ( path );
+}
+
+
 const ClientSocket& ClientSocket::operator << ( const std::string& s ) const
 {
-  if ( ! Socket::send ( s ) )
+  SocketResult<void> r = try_send ( s );
+  if ( ! r )
     {
-      throw SocketException ( "Could not write to socket." );
+      throw SocketException ( "Could not write to socket.", r.error() );
     }
 
   return *this;
@@ -33,10 +71,127 @@ const ClientSocket& ClientSocket::operator << ( const std::string& s ) const
 
 const ClientSocket& ClientSocket::operator >> ( std::string& s ) const
 {
-  if ( ! Socket::recv ( s ) )
+  SocketResult<size_t> r = try_recv ( s );
+  if ( ! r || *r == 0 )
     {
-      throw SocketException ( "Could not read from socket." );
+      throw SocketException ( "Could not read from socket.", r.error() );
     }
 
   return *this;
 }
+
+
+void ClientSocket::send_message ( const std::string& s ) const
+{
+  SocketResult<void> r = try_send_message ( s );
+  if ( ! r )
+    {
+      throw SocketException ( "Could not write message to socket.", r.error() );
+    }
+}
+
+
+void ClientSocket::recv_message ( std::string& s ) const
+{
+  SocketResult<bool> r = try_recv_message ( s );
+  if ( ! r || ! *r )
+    {
+      throw SocketException ( "Could not read message from socket.", r.error() );
+    }
+}
+
+
+size_t ClientSocket::recv_messages ( std::vector<std::string_view>& v ) const
+{
+  SocketResult<size_t> r = try_recv_messages ( v );
+  if ( ! r || *r == 0 )
+    {
+      throw SocketException ( "Could not read message from socket.", r.error() );
+    }
+
+  return *r;
+}
+
+
+void ClientSocket::send_messages ( std::span<const std::string_view> v ) const
+{
+  SocketResult<void> r = try_send_messages ( v );
+  if ( ! r )
+    {
+      throw SocketException ( "Could not write message to socket.", r.error() );
+    }
+}
+
+
+void ClientSocket::send_fds ( std::string_view s, std::span<const int> fds ) const
+{
+  SocketResult<void> r = try_send_fds ( s, fds );
+  if ( ! r )
+    {
+      throw SocketException ( "Could not pass descriptors on socket.", r.error() );
+    }
+}
+
+
+size_t ClientSocket::recv_fds ( std::span<char> buf, std::vector<int>& fds ) const
+{
+  SocketResult<size_t> r = try_recv_fds ( buf, fds );
+  if ( ! r || *r == 0 )
+    {
+      throw SocketException ( "Could not receive descriptors from socket.", r.error() );
+    }
+
+  return *r;
+}
+
+
+void ClientSocket::send ( std::initializer_list<std::string_view> pieces ) const
+{
+  SocketResult<void> r = try_send ( pieces );
+  if ( ! r )
+    {
+      throw SocketException ( "Could not write to socket.", r.error() );
+    }
+}
+
+
+SocketResult<void> ClientSocket::try_send ( std::initializer_list<std::string_view> pieces ) const
+{
+  std::vector<iovec> iov ( pieces.size() );
+
+  size_t i = 0;
+  for ( std::string_view piece : pieces )
+    {
+      iov[i].iov_base = const_cast<char*> ( piece.data() );
+      iov[i].iov_len = piece.size();
+      i++;
+    }
+
+  return Socket::send ( std::span<const iovec> ( iov ) );
+}
+
+
+void ClientSocket::cork()
+{
+  Socket::set_corked ( true );
+}
+
+
+void ClientSocket::uncork()
+{
+  SocketResult<void> r = try_uncork();
+  if ( ! r )
+    {
+      throw SocketException ( "Could not write to socket.", r.error() );
+    }
+}
+
+
+void ClientSocket::set_profile ( int profiles )
+{
+  SocketResult<void> r = try_set_profile ( profiles );
+  if ( ! r )
+    {
+      throw SocketException ( "Could not set socket options.", r.error() );
+    }
+}
@@ -4,6 +4,8 @@
 #define ClientSocket_class
 
 #include "Socket.h"
+#include <initializer_list>
+#include <string_view>
 
 
 class ClientSocket : private Socket
@@ -11,11 +13,80 @@ class ClientSocket : private Socket
  public:
 
   ClientSocket ( std::string host, int port );
+
+  // Connects to a local (AF_UNIX) socket instead; see Socket::bind_local.
+  ClientSocket ( const std::string& path );
+  ClientSocket (){};
   virtual ~ClientSocket(){};
 
+  // Move-only, like Socket.
+  ClientSocket ( ClientSocket&& ) = default;
+  ClientSocket& operator = ( ClientSocket&& ) = default;
+
   const ClientSocket& operator << ( const std::string& ) const;
   const ClientSocket& operator >> ( std::string& ) const;
 
+  void send_message ( const std::string& ) const;
+  void recv_message ( std::string& ) const;
+
+  // Pipelined messages; see Socket::recv_messages.
+  size_t recv_messages ( std::vector<std::string_view>& ) const;
+  void send_messages ( std::span<const std::string_view> ) const;
+
+  // Descriptor passing over a local socket; see Socket::send_fds.
+  void send_fds ( std::string_view, std::span<const int> ) const;
+  size_t recv_fds ( std::span<char>, std::vector<int>& ) const;
+
+  // Gather send, e.g. sock.send ( { header, body } ), in one sendmsg.
+  void send ( std::initializer_list<std::string_view> ) const;
+
+  // Coalesce the << writes between cork() and uncork() into one send.
+  void cork();
+  void uncork();
+
+  // TCP tuning for this connection; see Socket::set_profile.
+  void set_profile ( int profiles );
+
+  // The same operations without exceptions: failures carry their errno,
+  // and receives yield 0 (or false for messages) on orderly shutdown.
+  // try_connect is for a default-constructed socket.
+  SocketResult<void> try_connect ( std::string host, int port );
+  SocketResult<void> try_connect_local ( const std::string& path );
+  SocketResult<void> try_send ( std::string_view s ) const { return Socket::send ( std::span<const char> ( s ) ); }
+  SocketResult<void> try_send ( std::initializer_list<std::string_view> ) const;
+  SocketResult<size_t> try_recv ( std::string& s ) const { return Socket::recv ( s ); }
+  SocketResult<void> try_send_message ( const std::string& s ) const { return Socket::send_message ( s ); }
+  SocketResult<bool> try_recv_message ( std::string& s ) const { return Socket::recv_message ( s ); }
+  SocketResult<size_t> try_recv_messages ( std::vector<std::string_view>& v ) const { return Socket::recv_messages ( v ); }
+  SocketResult<void> try_send_messages ( std::span<const std::string_view> v ) const { return Socket::send_messages ( v ); }
+  SocketResult<void> try_uncork() { return Socket::set_corked ( false ); }
+  SocketResult<void> try_set_profile ( int profiles ) { return Socket::set_profile ( profiles ); }
+  SocketResult<void> try_set_no_delay ( bool b ) { return Socket::set_no_delay ( b ); }
+  SocketResult<void> try_set_quick_ack ( bool b ) { return Socket::set_quick_ack ( b ); }
+  SocketResult<void> try_set_tcp_cork ( bool b ) { return Socket::set_tcp_cork ( b ); }
+  SocketResult<void> try_set_busy_poll ( int usec ) { return Socket::set_busy_poll ( usec ); }
+  SocketResult<void> try_set_send_buffer ( int bytes ) { return Socket::set_send_buffer ( bytes ); }
+  SocketResult<void> try_set_recv_buffer ( int bytes ) { return Socket::set_recv_buffer ( bytes ); }
+  SocketResult<void> try_set_keep_alive ( int idle_s, int interval_s = KEEPALIVE_INTERVAL, int count = KEEPALIVE_COUNT ) { return Socket::set_keep_alive ( idle_s, interval_s, count ); }
+  SocketResult<int> send_buffer() const { return Socket::send_buffer(); }
+  SocketResult<int> recv_buffer() const { return Socket::recv_buffer(); }
+  SocketResult<void> try_send_fds ( std::string_view s, std::span<const int> fds ) const { return Socket::send_fds ( s, fds ); }
+  SocketResult<size_t> try_recv_fds ( std::span<char> buf, std::vector<int>& fds ) const { return Socket::recv_fds ( buf, fds ); }
+
+  bool is_alive() const { return Socket::is_alive(); }
+
+  // Non-blocking use with an EventLoop
+  ssize_t read_some ( char* buf, size_t len ) const { return Socket::read_some ( buf, len ); }
+  ssize_t write_some ( const char* buf, size_t len ) const { return Socket::write_some ( buf, len ); }
+
+  // Writes what earlier sends left kept; EAGAIN while some is still
+  // left, which pending() counts.
+  SocketResult<void> try_flush() const { return Socket::flush(); }
+  size_t pending() const { return Socket::pending(); }
+
+  void set_non_blocking ( const bool b ) { Socket::set_non_blocking ( b ); }
+  int fd() const { return Socket::fd(); }
+
 };
 
 
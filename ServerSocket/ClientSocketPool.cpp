@@ -0,0 +1,117 @@
+// Implementation of the ClientSocketPool class
+
+#include "ClientSocketPool.h"
+#include "SocketException.h"
+#include <exception>
+
+
+ClientSocketPool::Lease::Lease ( ClientSocketPool& pool, const std::string& host, int port,
+				 std::unique_ptr<ClientSocket> sock ) :
+  m_pool ( &pool ),
+  m_host ( host ),
+  m_port ( port ),
+  m_sock ( std::move ( sock ) ),
+  m_discard ( false ),
+  m_exceptions ( std::uncaught_exceptions() )
+{
+}
+
+ClientSocketPool::Lease::Lease ( Lease&& other ) :
+  m_pool ( other.m_pool ),
+  m_host ( std::move ( other.m_host ) ),
+  m_port ( other.m_port ),
+  m_sock ( std::move ( other.m_sock ) ),
+  m_discard ( other.m_discard ),
+  m_exceptions ( other.m_exceptions )
+{
+}
+
+ClientSocketPool::Lease::~Lease()
+{
+  if ( ! m_sock )
+    return;
+
+  bool reuse = ! m_discard && std::uncaught_exceptions() == m_exceptions;
+  m_pool->release ( m_host, m_port, std::move ( m_sock ), reuse );
+}
+
+
+ClientSocketPool::ClientSocketPool ( size_t max_per_host, std::chrono::seconds max_idle ) :
+  m_max_per_host ( max_per_host > 0 ? max_per_host : 1 ),
+  m_max_idle ( max_idle )
+{
+}
+
+
+ClientSocketPool::Lease ClientSocketPool::acquire ( const std::string& host, int port )
+{
+  std::unique_lock<std::mutex> lock ( m_mutex );
+  Host& h = m_hosts[Key ( host, port )];
+
+  while ( true )
+    {
+      // Newest first: the most recently used connection is the least
+      // likely to have been dropped by the peer.
+      while ( ! h.idle.empty() )
+	{
+	  Idle i = std::move ( h.idle.back() );
+	  h.idle.pop_back();
+
+	  if ( Clock::now() - i.since < m_max_idle && i.sock->is_alive() )
+	    return Lease ( *this, host, port, std::move ( i.sock ) );
+
+	  h.open--;
+	}
+
+      if ( h.open < m_max_per_host )
+	break;
+
+      m_returned.wait ( lock );
+    }
+
+  // Connect outside the lock; the slot is reserved meanwhile.
+  h.open++;
+  lock.unlock();
+
+  try
+    {
+      return Lease ( *this, host, port, std::unique_ptr<ClientSocket> ( new ClientSocket ( host, port ) ) );
+    }
+  catch ( SocketException& )
+    {
+      lock.lock();
+      h.open--;
+      m_returned.notify_one();
+      throw;
+    }
+}
+
+
+size_t ClientSocketPool::idle ( const std::string& host, int port )
+{
+  std::lock_guard<std::mutex> lock ( m_mutex );
+
+  return m_hosts[Key ( host, port )].idle.size();
+}
+
+
+void ClientSocketPool::release ( const std::string& host, int port,
+				 std::unique_ptr<ClientSocket> sock, bool reuse )
+{
+  {
+    std::lock_guard<std::mutex> lock ( m_mutex );
+    Host& h = m_hosts[Key ( host, port )];
+
+    if ( reuse )
+      {
+	Idle i;
+	i.sock = std::move ( sock );
+	i.since = Clock::now();
+	h.idle.push_back ( std::move ( i ) );
+      }
+    else
+      h.open--;
+  }
+
+  m_returned.notify_one();
+}
@@ -0,0 +1,101 @@
+// Definition of the ClientSocketPool class
+
+#ifndef ClientSocketPool_class
+#define ClientSocketPool_class
+
+#include "ClientSocket.h"
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+const size_t POOL_MAX_PER_HOST = 8;
+const int POOL_IDLE_SECONDS = 60;
+
+// Keeps warm ClientSockets per (host, port). acquire() hands out an idle
+// connection that is still alive, or opens a new one while fewer than
+// max_per_host exist, or waits for one to be returned. A Lease gives the
+// connection back when it goes out of scope, unless it was discarded or
+// is being destroyed by an exception, in which case the connection is
+// closed since its state is unknown.
+class ClientSocketPool
+{
+ public:
+
+  class Lease
+  {
+   public:
+
+    Lease ( Lease&& );
+    ~Lease();
+
+    ClientSocket& operator * () const { return *m_sock; }
+    ClientSocket* operator -> () const { return m_sock.get(); }
+
+    // Close the connection instead of returning it to the pool.
+    void discard() { m_discard = true; }
+
+   private:
+
+    friend class ClientSocketPool;
+
+    Lease ( ClientSocketPool& pool, const std::string& host, int port, std::unique_ptr<ClientSocket> sock );
+    Lease ( const Lease& );
+    Lease& operator = ( const Lease& );
+
+    ClientSocketPool* m_pool;
+    std::string m_host;
+    int m_port;
+    std::unique_ptr<ClientSocket> m_sock;
+    bool m_discard;
+    int m_exceptions;
+
+  };
+
+  ClientSocketPool ( size_t max_per_host = POOL_MAX_PER_HOST,
+		     std::chrono::seconds max_idle = std::chrono::seconds ( POOL_IDLE_SECONDS ) );
+  virtual ~ClientSocketPool() {};
+
+  // Throws SocketException if a new connection cannot be opened.
+  Lease acquire ( const std::string& host, int port );
+
+  size_t idle ( const std::string& host, int port );
+
+ private:
+
+  ClientSocketPool ( const ClientSocketPool& );
+  ClientSocketPool& operator = ( const ClientSocketPool& );
+
+  typedef std::chrono::steady_clock Clock;
+  typedef std::pair<std::string, int> Key;
+
+  struct Idle
+  {
+    std::unique_ptr<ClientSocket> sock;
+    Clock::time_point since;
+  };
+
+  struct Host
+  {
+    std::vector<Idle> idle;   // most recently returned last
+    size_t open;              // idle plus leased
+  };
+
+  void release ( const std::string& host, int port, std::unique_ptr<ClientSocket>, bool reuse );
+
+  size_t m_max_per_host;
+  std::chrono::seconds m_max_idle;
+
+  std::mutex m_mutex;
+  std::condition_variable m_returned;
+  std::map<Key, Host> m_hosts;
+
+};
+
+
+#endif
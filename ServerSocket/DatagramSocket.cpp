@@ -0,0 +1,388 @@
+// Implementation of the DatagramSocket class
+
+#include "DatagramSocket.h"
+#include "SocketException.h"
+#include <arpa/inet.h>
+#include <netinet/udp.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+
+// Largest payload one GSO send may carry.
+const size_t DGRAM_GSO_MAX = 65000;
+
+const size_t RECV_CONTROL = CMSG_SPACE ( sizeof ( int ) );
+const size_t SEND_CONTROL = CMSG_SPACE ( sizeof ( uint16_t ) );
+
+
+DatagramSocket::DatagramSocket ( int port, bool reuse_port, size_t batch ) :
+  m_sock ( -1 ),
+  m_batch ( batch ? batch : 1 ),
+  m_connected ( false ),
+  m_gro ( false ),
+  m_gso ( false ),
+  m_rslot ( DGRAM_SIZE ),
+  m_wslab ( m_batch * DGRAM_SIZE ),
+  m_wlen ( m_batch ),
+  m_waddr ( m_batch ),
+  m_wmsgs ( m_batch ),
+  m_wiov ( m_batch ),
+  m_wctrl ( m_batch * SEND_CONTROL ),
+  m_wfirst ( m_batch + 1 ),
+  m_wcount ( 0 )
+{
+  m_sock = socket ( AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0 );
+
+  if ( m_sock == -1 )
+    {
+      throw SocketException ( "Could not create datagram socket.", errno );
+    }
+
+  int on = 1;
+  if ( reuse_port && setsockopt ( m_sock, SOL_SOCKET, SO_REUSEPORT, &on, sizeof ( on ) ) == -1 )
+    {
+      int e = errno;
+      ::close ( m_sock );
+      throw SocketException ( "Could not set SO_REUSEPORT.", e );
+    }
+
+  sockaddr_in addr = sockaddr_in();
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = INADDR_ANY;
+  addr.sin_port = htons ( port );
+
+  if ( ::bind ( m_sock, ( sockaddr * ) &addr, sizeof ( addr ) ) == -1 )
+    {
+      int e = errno;
+      ::close ( m_sock );
+      throw SocketException ( "Could not bind to port.", e );
+    }
+
+  setup_recv();
+}
+
+DatagramSocket::~DatagramSocket()
+{
+  if ( m_sock != -1 )
+    ::close ( m_sock );
+}
+
+
+// Points every receive header at its slot; called again when GRO changes
+// the slot size.
+void DatagramSocket::setup_recv()
+{
+  m_rslab.assign ( m_batch * m_rslot, 0 );
+  m_rmsgs.assign ( m_batch, mmsghdr() );
+  m_riov.resize ( m_batch );
+  m_raddr.resize ( m_batch );
+  m_rctrl.assign ( m_batch * RECV_CONTROL, 0 );
+  m_datagrams.clear();
+  m_datagrams.reserve ( m_batch );
+
+  for ( size_t i = 0; i < m_batch; i++ )
+    {
+      m_riov[i].iov_base = &m_rslab[i * m_rslot];
+      m_riov[i].iov_len = m_rslot;
+
+      msghdr& h = m_rmsgs[i].msg_hdr;
+      h.msg_iov = &m_riov[i];
+      h.msg_iovlen = 1;
+      h.msg_name = &m_raddr[i];
+    }
+}
+
+
+SocketResult<void> DatagramSocket::connect ( const std::string host, const int port )
+{
+  sockaddr_in addr = sockaddr_in();
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons ( port );
+
+  if ( inet_pton ( AF_INET, host.c_str(), &addr.sin_addr ) != 1 )
+    return SocketError ( EAFNOSUPPORT );
+
+  if ( ::connect ( m_sock, ( sockaddr * ) &addr, sizeof ( addr ) ) == -1 )
+    return SocketError ( errno );
+
+  m_connected = true;
+
+  return {};
+}
+
+
+SocketResult<void> DatagramSocket::set_receive_buffer ( size_t bytes )
+{
+  int size = bytes;
+  if ( setsockopt ( m_sock, SOL_SOCKET, SO_RCVBUF, &size, sizeof ( size ) ) == -1 )
+    return SocketError ( errno );
+
+  return {};
+}
+
+
+SocketResult<void> DatagramSocket::set_gro ( const bool b )
+{
+  int on = b;
+  if ( setsockopt ( m_sock, SOL_UDP, UDP_GRO, &on, sizeof ( on ) ) == -1 )
+    return SocketError ( errno );
+
+  // A coalesced read can be up to 64KB, so the slots grow to match.
+  m_gro = b;
+  m_rslot = b ? DGRAM_GRO_SIZE : DGRAM_SIZE;
+  setup_recv();
+
+  return {};
+}
+
+
+SocketResult<void> DatagramSocket::set_gso ( const bool b )
+{
+  // Segment size 0 leaves sends alone; it only checks for support.
+  int zero = 0;
+  if ( b && setsockopt ( m_sock, SOL_UDP, UDP_SEGMENT, &zero, sizeof ( zero ) ) == -1 )
+    return SocketError ( errno );
+
+  m_gso = b;
+
+  return {};
+}
+
+
+SocketResult<size_t> DatagramSocket::recv_batch()
+{
+  m_datagrams.clear();
+
+  for ( size_t i = 0; i < m_batch; i++ )
+    {
+      msghdr& h = m_rmsgs[i].msg_hdr;
+      h.msg_namelen = sizeof ( sockaddr_in );
+      h.msg_control = m_gro ? &m_rctrl[i * RECV_CONTROL] : 0;
+      h.msg_controllen = m_gro ? RECV_CONTROL : 0;
+      h.msg_flags = 0;
+    }
+
+  int n;
+
+  // MSG_WAITFORONE: block for the first datagram only, then take
+  // whatever else is already queued.
+  do
+    n = ::recvmmsg ( m_sock, &m_rmsgs[0], m_batch, MSG_WAITFORONE, 0 );
+  while ( n == -1 && errno == EINTR );
+
+  if ( n == -1 )
+    return SocketError ( errno );
+
+  for ( int i = 0; i < n; i++ )
+    {
+      const char* data = &m_rslab[i * m_rslot];
+      size_t len = m_rmsgs[i].msg_len;
+      size_t segment = len;
+
+      if ( m_gro )
+	{
+	  msghdr& h = m_rmsgs[i].msg_hdr;
+	  for ( cmsghdr* c = CMSG_FIRSTHDR ( &h ); c; c = CMSG_NXTHDR ( &h, c ) )
+	    if ( c->cmsg_level == SOL_UDP && c->cmsg_type == UDP_GRO )
+	      {
+		int gs;
+		memcpy ( &gs, CMSG_DATA ( c ), sizeof ( gs ) );
+		if ( gs > 0 )
+		  segment = gs;
+	      }
+	}
+
+      // A zero-length datagram is still a datagram.
+      size_t off = 0;
+      do
+	{
+	  size_t part = std::min ( segment, len - off );
+	  Datagram d = { std::string_view ( data + off, part ), &m_raddr[i] };
+	  m_datagrams.push_back ( d );
+	  off += part;
+	}
+      while ( off < len );
+    }
+
+  return m_datagrams.size();
+}
+
+
+SocketResult<void> DatagramSocket::queue ( std::string_view s )
+{
+  if ( ! m_connected )
+    return SocketError ( EDESTADDRREQ );
+
+  sockaddr_in none = sockaddr_in();
+  return queue ( s, none );
+}
+
+
+SocketResult<void> DatagramSocket::queue ( std::string_view s, const sockaddr_in& to )
+{
+  if ( m_wcount == m_batch )
+    {
+      SocketResult<size_t> r = flush();
+      if ( ! r )
+	return SocketError ( r.error() );
+      if ( m_wcount == m_batch )
+	return SocketError ( EAGAIN );
+    }
+
+  if ( s.size() > DGRAM_SIZE )
+    {
+      // Keep datagrams in order: the queue goes first.
+      SocketResult<size_t> r = flush();
+      if ( ! r )
+	return SocketError ( r.error() );
+      if ( m_wcount )
+	return SocketError ( EAGAIN );
+
+      ssize_t status;
+      do
+	status = to.sin_family
+	  ? ::sendto ( m_sock, s.data(), s.size(), 0, ( const sockaddr * ) &to, sizeof ( to ) )
+	  : ::send ( m_sock, s.data(), s.size(), 0 );
+      while ( status == -1 && errno == EINTR );
+
+      if ( status == -1 )
+	return SocketError ( errno );
+
+      return {};
+    }
+
+  memcpy ( &m_wslab[m_wcount * DGRAM_SIZE], s.data(), s.size() );
+  m_wlen[m_wcount] = s.size();
+  m_waddr[m_wcount] = to;
+  m_wcount++;
+
+  return {};
+}
+
+
+static bool same_peer ( const sockaddr_in& a, const sockaddr_in& b )
+{
+  return a.sin_family == b.sin_family && a.sin_port == b.sin_port
+    && a.sin_addr.s_addr == b.sin_addr.s_addr;
+}
+
+
+SocketResult<size_t> DatagramSocket::flush()
+{
+  size_t sent = 0;
+
+  while ( m_wcount > 0 )
+    {
+      // Build one message per datagram, or per run of datagrams to the
+      // same peer when GSO can send them as one.
+      size_t nmsgs = 0;
+      m_wfirst[0] = 0;
+
+      for ( size_t i = 0; i < m_wcount; )
+	{
+	  size_t j = i + 1;
+	  size_t total = m_wlen[i];
+
+	  // A GSO run: equal sizes, except that the last may be shorter.
+	  if ( m_gso && m_wlen[i] > 0 )
+	    while ( j < m_wcount && j - i < DGRAM_GSO_SEGMENTS
+		    && m_wlen[j] > 0 && m_wlen[j] <= m_wlen[i] && m_wlen[j - 1] == m_wlen[i]
+		    && total + m_wlen[j] <= DGRAM_GSO_MAX
+		    && same_peer ( m_waddr[j], m_waddr[i] ) )
+	      total += m_wlen[j++];
+
+	  for ( size_t k = i; k < j; k++ )
+	    {
+	      m_wiov[k].iov_base = &m_wslab[k * DGRAM_SIZE];
+	      m_wiov[k].iov_len = m_wlen[k];
+	    }
+
+	  msghdr& h = m_wmsgs[nmsgs].msg_hdr;
+	  h = msghdr();
+	  h.msg_iov = &m_wiov[i];
+	  h.msg_iovlen = j - i;
+
+	  if ( m_waddr[i].sin_family )
+	    {
+	      h.msg_name = &m_waddr[i];
+	      h.msg_namelen = sizeof ( sockaddr_in );
+	    }
+
+	  if ( j - i > 1 )
+	    {
+	      h.msg_control = &m_wctrl[nmsgs * SEND_CONTROL];
+	      h.msg_controllen = SEND_CONTROL;
+
+	      cmsghdr* c = CMSG_FIRSTHDR ( &h );
+	      c->cmsg_level = SOL_UDP;
+	      c->cmsg_type = UDP_SEGMENT;
+	      c->cmsg_len = CMSG_LEN ( sizeof ( uint16_t ) );
+	      uint16_t gs = m_wlen[i];
+	      memcpy ( CMSG_DATA ( c ), &gs, sizeof ( gs ) );
+	    }
+
+	  nmsgs++;
+	  m_wfirst[nmsgs] = j;
+	  i = j;
+	}
+
+      int n;
+
+      do
+	n = ::sendmmsg ( m_sock, &m_wmsgs[0], nmsgs, 0 );
+      while ( n == -1 && errno == EINTR );
+
+      if ( n == -1 )
+	{
+	  if ( errno == EAGAIN || errno == EWOULDBLOCK )
+	    return sent;
+
+	  // The first message failed outright (e.g. ECONNREFUSED from an
+	  // earlier ICMP error); drop it so the queue can move on.
+	  int e = errno;
+	  drop ( m_wfirst[1] );
+	  return SocketError ( e );
+	}
+
+      sent += m_wfirst[n];
+      drop ( m_wfirst[n] );
+    }
+
+  return sent;
+}
+
+
+// Removes the first count queued datagrams. Only a partial or failed
+// sendmmsg leaves any behind to move.
+void DatagramSocket::drop ( size_t count )
+{
+  m_wcount -= count;
+
+  if ( m_wcount == 0 )
+    return;
+
+  memmove ( &m_wslab[0], &m_wslab[count * DGRAM_SIZE], m_wcount * DGRAM_SIZE );
+  std::copy ( m_wlen.begin() + count, m_wlen.begin() + count + m_wcount, m_wlen.begin() );
+  std::copy ( m_waddr.begin() + count, m_waddr.begin() + count + m_wcount, m_waddr.begin() );
+}
+
+
+void DatagramSocket::set_non_blocking ( const bool b )
+{
+  int opts = fcntl ( m_sock, F_GETFL );
+
+  if ( opts < 0 )
+    return;
+
+  fcntl ( m_sock, F_SETFL, b ? opts | O_NONBLOCK : opts & ~O_NONBLOCK );
+}
@@ -0,0 +1,111 @@
+// Definition of the DatagramSocket class
+
+#ifndef DatagramSocket_class
+#define DatagramSocket_class
+
+#include "SocketResult.h"
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+const size_t DGRAM_BATCH = 64;
+const size_t DGRAM_SIZE = 2048;
+const size_t DGRAM_GRO_SIZE = 65536;
+const size_t DGRAM_GSO_SEGMENTS = 64;
+
+// A UDP socket that moves datagrams in batches: one recvmmsg fills up to
+// DGRAM_BATCH slots of a slab allocated up front, and queued sends go out
+// in one sendmmsg. Nothing is allocated per packet.
+//
+// With GRO on, the kernel may hand over several same-sized datagrams from
+// one peer as a single buffer; they are split again here, so callers see
+// ordinary datagrams. With GSO on, runs of equal-sized datagrams to one
+// peer are sent as a single message that the kernel or NIC segments.
+class DatagramSocket
+{
+ public:
+
+  struct Datagram
+  {
+    std::string_view data;
+    const sockaddr_in* peer;
+  };
+
+  // Binds to the port, or an ephemeral one for 0; throws SocketException.
+  DatagramSocket ( int port = 0, bool reuse_port = false, size_t batch = DGRAM_BATCH );
+  virtual ~DatagramSocket();
+
+  // Sets the peer used by queue() without an address, and filters
+  // incoming datagrams to that peer.
+  SocketResult<void> connect ( const std::string host, const int port );
+
+  // Bursts that outrun the reader are dropped once the kernel buffer is
+  // full; ingestion sinks want it large. Capped by net.core.rmem_max.
+  SocketResult<void> set_receive_buffer ( size_t bytes );
+
+  // Both fail with ENOPROTOOPT on kernels without support.
+  SocketResult<void> set_gro ( const bool );
+  SocketResult<void> set_gso ( const bool );
+
+  // Receives one batch with a single recvmmsg; blocks for the first
+  // datagram unless the socket is non-blocking. The views stay valid
+  // until the next recv_batch.
+  SocketResult<size_t> recv_batch();
+  std::span<const Datagram> datagrams() const { return m_datagrams; }
+
+  // Copies the datagram into the send slab, flushing first if the slab is
+  // full. Datagrams larger than DGRAM_SIZE are sent at once.
+  SocketResult<void> queue ( std::string_view, const sockaddr_in& to );
+  SocketResult<void> queue ( std::string_view );
+
+  // Sends what is queued with as few sendmmsg calls as the kernel allows;
+  // returns the number of datagrams sent. What a non-blocking socket
+  // could not take stays queued.
+  SocketResult<size_t> flush();
+  size_t queued() const { return m_wcount; }
+
+  void set_non_blocking ( const bool );
+  int fd() const { return m_sock; }
+
+ private:
+
+  DatagramSocket ( const DatagramSocket& );
+  DatagramSocket& operator = ( const DatagramSocket& );
+
+  void setup_recv();
+  void drop ( size_t count );
+
+  int m_sock;
+  size_t m_batch;
+  bool m_connected;
+  bool m_gro;
+  bool m_gso;
+
+  // Receive side: m_batch slots of m_rslot bytes each.
+  size_t m_rslot;
+  std::vector<char> m_rslab;
+  std::vector<mmsghdr> m_rmsgs;
+  std::vector<iovec> m_riov;
+  std::vector<sockaddr_in> m_raddr;
+  std::vector<char> m_rctrl;
+  std::vector<Datagram> m_datagrams;
+
+  // Send side: m_batch slots of DGRAM_SIZE bytes each.
+  std::vector<char> m_wslab;
+  std::vector<size_t> m_wlen;
+  std::vector<sockaddr_in> m_waddr;
+  std::vector<mmsghdr> m_wmsgs;
+  std::vector<iovec> m_wiov;
+  std::vector<char> m_wctrl;
+  std::vector<size_t> m_wfirst;   // first datagram of each message
+  size_t m_wcount;
+
+};
+
+
+#endif
@@ -0,0 +1,210 @@
+// Implementation of the EventLoop class
+
+#include "EventLoop.h"
+#include "SocketException.h"
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <errno.h>
+
+
+EventLoop::EventLoop() :
+  m_epfd ( -1 ),
+  m_running ( false ),
+  m_count ( 0 )
+{
+  m_epfd = epoll_create1 ( EPOLL_CLOEXEC );
+
+  if ( m_epfd == -1 )
+    {
+      throw SocketException ( "Could not create epoll instance." );
+    }
+}
+
+EventLoop::~EventLoop()
+{
+  if ( m_epfd != -1 )
+    ::close ( m_epfd );
+}
+
+
+bool EventLoop::add ( int fd, Callback on_read, Callback on_write )
+{
+  if ( fd < 0 )
+    return false;
+
+  if ( ( size_t ) fd >= m_handlers.size() )
+    m_handlers.resize ( fd + 1 );
+
+  if ( m_handlers[fd] )
+    return false;
+
+  // A spare handler still referenced is being dispatched right now.
+  std::shared_ptr<Handler> h;
+
+  if ( ! m_spare.empty() && m_spare.back().use_count() == 1 )
+    {
+      h.swap ( m_spare.back() );
+      m_spare.pop_back();
+    }
+  else
+    h = std::make_shared<Handler>();
+
+  h->on_read = on_read;
+  h->on_write = on_write;
+  h->want_read = true;
+  h->want_write = false;
+
+  epoll_event ev = epoll_event();
+  ev.events = EPOLLIN | EPOLLRDHUP;
+  ev.data.fd = fd;
+
+  if ( epoll_ctl ( m_epfd, EPOLL_CTL_ADD, fd, &ev ) == -1 )
+    return false;
+
+  m_handlers[fd] = h;
+  m_count++;
+
+  return true;
+}
+
+
+bool EventLoop::set_read_interest ( int fd, const bool b )
+{
+  Handler* h = find ( fd );
+
+  if ( ! h )
+    return false;
+
+  if ( h->want_read == b )
+    return true;
+
+  h->want_read = b;
+
+  return update ( fd, *h );
+}
+
+
+bool EventLoop::set_write_interest ( int fd, const bool b )
+{
+  Handler* h = find ( fd );
+
+  if ( ! h )
+    return false;
+
+  if ( h->want_write == b )
+    return true;
+
+  h->want_write = b;
+
+  return update ( fd, *h );
+}
+
+
+EventLoop::Handler* EventLoop::find ( int fd )
+{
+  if ( fd < 0 || ( size_t ) fd >= m_handlers.size() )
+    return 0;
+
+  return m_handlers[fd].get();
+}
+
+
+bool EventLoop::update ( int fd, const Handler& h )
+{
+  epoll_event ev = epoll_event();
+  ev.events = ( h.want_read ? ( uint32_t ) ( EPOLLIN | EPOLLRDHUP ) : 0 ) | ( h.want_write ? ( uint32_t ) EPOLLOUT : 0 );
+  ev.data.fd = fd;
+
+  return epoll_ctl ( m_epfd, EPOLL_CTL_MOD, fd, &ev ) != -1;
+}
+
+
+bool EventLoop::remove ( int fd )
+{
+  if ( ! find ( fd ) )
+    return false;
+
+  // Callbacks may remove their own descriptor; run_once holds a reference
+  // to the handler until the callback returns, so only an idle one has
+  // its callbacks dropped here.
+  std::shared_ptr<Handler>& h = m_handlers[fd];
+
+  if ( h.use_count() == 1 )
+    {
+      h->on_read = Callback();
+      h->on_write = Callback();
+    }
+
+  if ( m_spare.size() < LOOP_MAX_SPARE )
+    m_spare.push_back ( std::move ( h ) );
+  else
+    h.reset();
+
+  m_count--;
+
+  if ( epoll_ctl ( m_epfd, EPOLL_CTL_DEL, fd, 0 ) == -1 )
+    return false;
+
+  return true;
+}
+
+
+int EventLoop::run_once ( int timeout_ms )
+{
+  epoll_event events [ MAXEVENTS ];
+
+  int next = m_timers.next_timeout();
+  if ( next >= 0 && ( timeout_ms < 0 || next < timeout_ms ) )
+    timeout_ms = next;
+
+  int n = epoll_wait ( m_epfd, events, MAXEVENTS, timeout_ms );
+
+  if ( n == -1 )
+    {
+      if ( errno != EINTR )
+	throw SocketException ( "Could not wait for events." );
+
+      n = 0;
+    }
+
+  // Timers first. This also brings the wheel's clock up to date before
+  // the callbacks below arm new deadlines.
+  m_timers.expire();
+
+  for ( int i = 0; i < n; i++ )
+    {
+      int fd = events[i].data.fd;
+
+      if ( ( size_t ) fd >= m_handlers.size() || ! m_handlers[fd] )
+	continue;
+
+      std::shared_ptr<Handler> h = m_handlers[fd];
+
+      // Errors and hang-ups are reported through the read callback, whose
+      // next read returns 0 or -1.
+      if ( events[i].events & ( EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR ) )
+	{
+	  if ( h->on_read )
+	    h->on_read();
+	}
+
+      // The read callback may have closed the connection, or the fd may
+      // already belong to a new one.
+      if ( m_handlers[fd] != h )
+	continue;
+
+      if ( ( events[i].events & EPOLLOUT ) && h->on_write )
+	h->on_write();
+    }
+
+  return n;
+}
+
+
+void EventLoop::run()
+{
+  m_running = true;
+
+  while ( m_running )
+    run_once();
+}
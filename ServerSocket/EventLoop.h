@@ -0,0 +1,69 @@
+// Definition of the EventLoop class
+
+#ifndef EventLoop_class
+#define EventLoop_class
+
+#include "TimerWheel.h"
+#include <functional>
+#include <memory>
+#include <vector>
+
+
+const int MAXEVENTS = 256;
+const size_t LOOP_MAX_SPARE = 1024;
+
+// A level-triggered epoll reactor. Each registered descriptor gets a read
+// callback and an optional write callback; write interest is switched on
+// only while a connection has output pending, and read interest can be
+// switched off to apply backpressure. Timers armed on timers() fire from
+// the same loop, which never sleeps past the next deadline. Removed
+// handlers are kept for the next add(), so churn does not malloc.
+class EventLoop
+{
+ public:
+
+  typedef std::function<void ()> Callback;
+
+  EventLoop();
+  virtual ~EventLoop();
+
+  bool add ( int fd, Callback on_read, Callback on_write = Callback() );
+  bool set_read_interest ( int fd, const bool );
+  bool set_write_interest ( int fd, const bool );
+  bool remove ( int fd );
+
+  // Dispatch one batch of ready events; returns the number handled.
+  int run_once ( int timeout_ms = -1 );
+  void run();
+  void stop() { m_running = false; }
+
+  size_t size() const { return m_count; }
+  TimerWheel& timers() { return m_timers; }
+
+ private:
+
+  EventLoop ( const EventLoop& );
+  EventLoop& operator = ( const EventLoop& );
+
+  struct Handler
+  {
+    Callback on_read;
+    Callback on_write;
+    bool want_read;
+    bool want_write;
+  };
+
+  Handler* find ( int fd );
+  bool update ( int fd, const Handler& );
+
+  int m_epfd;
+  bool m_running;
+  size_t m_count;
+  std::vector<std::shared_ptr<Handler> > m_handlers;
+  std::vector<std::shared_ptr<Handler> > m_spare;   // removed, for reuse
+  TimerWheel m_timers;
+
+};
+
+
+#endif
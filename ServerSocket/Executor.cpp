@@ -0,0 +1,72 @@
+// Implementation of the Executor class
+
+#include "Executor.h"
+#include "SocketException.h"
+
+
+void Executor::wait ( int fd, const bool write, IoAwaiter* a )
+{
+  if ( ( size_t ) fd >= m_waiters.size() )
+    m_waiters.resize ( fd + 1 );
+
+  Waiters& w = m_waiters[fd];
+
+  if ( ! w.registered )
+    {
+      if ( ! m_loop.add ( fd, [this, fd] { ready ( fd, false ); }, [this, fd] { ready ( fd, true ); } ) )
+	{
+	  throw SocketException ( "Could not watch socket." );
+	}
+
+      w.registered = true;
+    }
+
+  if ( write )
+    {
+      w.writer = a;
+      m_loop.set_write_interest ( fd, true );
+    }
+  else
+    {
+      w.reader = a;
+      m_loop.set_read_interest ( fd, true );
+    }
+}
+
+
+void Executor::forget ( int fd )
+{
+  if ( ( size_t ) fd >= m_waiters.size() || ! m_waiters[fd].registered )
+    return;
+
+  m_loop.remove ( fd );
+  m_waiters[fd] = Waiters();
+}
+
+
+void Executor::ready ( int fd, const bool write )
+{
+  Waiters& w = m_waiters[fd];
+  IoAwaiter*& slot = write ? w.writer : w.reader;
+
+  if ( ! slot )
+    {
+      // Nobody waiting in this direction any more.
+      if ( write )
+	m_loop.set_write_interest ( fd, false );
+      else
+	m_loop.set_read_interest ( fd, false );
+      return;
+    }
+
+  if ( ! slot->attempt() )
+    return;
+
+  // Interest stays on: a coroutine that waits again right away saves two
+  // epoll_ctl calls, and a spurious event just switches it off above.
+  IoAwaiter* a = slot;
+  slot = 0;
+
+  // The coroutine may close the socket or wait again before this returns.
+  a->m_handle.resume();
+}
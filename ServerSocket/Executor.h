@@ -0,0 +1,84 @@
+// Definition of the Executor class
+
+#ifndef Executor_class
+#define Executor_class
+
+#include "EventLoop.h"
+#include <coroutine>
+#include <vector>
+
+
+// An operation a coroutine is suspended on. attempt() retries it without
+// blocking and returns false while it would still block.
+class IoAwaiter
+{
+ public:
+
+  virtual ~IoAwaiter() {};
+  virtual bool attempt() = 0;
+
+  std::coroutine_handle<> m_handle;
+
+};
+
+// Resumes coroutines from an EventLoop once the descriptor they wait on
+// is ready and their operation completes. Interest in a descriptor is
+// switched off once an event arrives that nobody waits for. One Executor
+// belongs to one thread; for more threads, run one Executor per thread.
+class Executor
+{
+ public:
+
+  Executor() {};
+  virtual ~Executor() {};
+
+  void wait ( int fd, const bool write, IoAwaiter* );
+
+  // Must be called before a descriptor with waiters registered is closed.
+  void forget ( int fd );
+
+  // Resumes the coroutine after ms, from the loop's timer wheel:
+  //   co_await exec.sleep ( 100 );
+  class SleepAwaiter
+  {
+   public:
+    SleepAwaiter ( Executor& e, uint64_t ms ) : m_exec ( e ), m_ms ( ms ) {};
+    bool await_ready() { return m_ms == 0; }
+    void await_suspend ( std::coroutine_handle<> h ) { m_timer.set_callback ( [h] { h.resume(); } ); m_exec.m_loop.timers().arm ( m_timer, m_ms ); }
+    void await_resume() {}
+   private:
+    Executor& m_exec;
+    uint64_t m_ms;
+    TimerWheel::Timer m_timer;
+  };
+
+  SleepAwaiter sleep ( uint64_t ms ) { return SleepAwaiter ( *this, ms ); }
+
+  void run() { m_loop.run(); }
+  void stop() { m_loop.stop(); }
+
+  EventLoop& loop() { return m_loop; }
+
+ private:
+
+  Executor ( const Executor& );
+  Executor& operator = ( const Executor& );
+
+  struct Waiters
+  {
+    Waiters() : registered ( false ), reader ( 0 ), writer ( 0 ) {};
+
+    bool registered;
+    IoAwaiter* reader;
+    IoAwaiter* writer;
+  };
+
+  void ready ( int fd, const bool write );
+
+  EventLoop m_loop;
+  std::vector<Waiters> m_waiters;   // indexed by descriptor
+
+};
+
+
+#endif
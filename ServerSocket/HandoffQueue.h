@@ -0,0 +1,158 @@
+// Definition of the HandoffQueue class
+
+#ifndef HandoffQueue_class
+#define HandoffQueue_class
+
+#include "Slab.h"
+#include "SocketException.h"
+#include <errno.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <atomic>
+#include <memory>
+#include <utility>
+
+
+// A bounded lock-free queue for passing accepted descriptors or messages
+// from any number of threads to one consumer loop. Each cell carries a
+// sequence number, so producers claim cells with a single CAS and the
+// consumer never takes a lock (Vyukov's bounded queue, single-consumer).
+//
+// fd() is an eventfd for the consumer's EventLoop. Producers only write
+// to it when the consumer may be asleep, so a busy consumer costs them
+// no syscalls:
+//
+//   loop.add ( q.fd(), [&] { q.clear_wakeup(); while ( q.pop ( v ) ) ...; } );
+//
+// push fails when the queue is full; what to do then - retry, close the
+// connection - is the producer's call.
+template <class T>
+class HandoffQueue
+{
+ public:
+
+  HandoffQueue ( size_t capacity ) :
+    m_mask ( round_up ( capacity ) - 1 ),
+    m_cells ( new Cell [ m_mask + 1 ] ),
+    m_tail ( 0 ),
+    m_head ( 0 ),
+    m_signalled ( false )
+  {
+    for ( size_t i = 0; i <= m_mask; i++ )
+      m_cells[i].seq.store ( i, std::memory_order_relaxed );
+
+    m_efd = eventfd ( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+
+    if ( m_efd == -1 )
+      {
+	throw SocketException ( "Could not create eventfd.", errno );
+      }
+  }
+
+  virtual ~HandoffQueue() { ::close ( m_efd ); }
+
+  // Any thread.
+  bool push ( T v )
+  {
+    size_t pos = m_tail.load ( std::memory_order_relaxed );
+    Cell* c;
+
+    while ( true )
+      {
+	c = &m_cells[pos & m_mask];
+	size_t seq = c->seq.load ( std::memory_order_acquire );
+	intptr_t diff = ( intptr_t ) seq - ( intptr_t ) pos;
+
+	if ( diff == 0 && m_tail.compare_exchange_weak ( pos, pos + 1, std::memory_order_relaxed ) )
+	  break;
+
+	if ( diff < 0 )
+	  return false;   // full
+
+	if ( diff > 0 )
+	  pos = m_tail.load ( std::memory_order_relaxed );
+      }
+
+    c->value = std::move ( v );
+    c->seq.store ( pos + 1, std::memory_order_release );
+
+    // Pairs with the fence in clear_wakeup: either the consumer sees
+    // this cell or this producer sees the flag cleared.
+    std::atomic_thread_fence ( std::memory_order_seq_cst );
+
+    if ( ! m_signalled.load ( std::memory_order_relaxed ) && ! m_signalled.exchange ( true ) )
+      {
+	uint64_t one = 1;
+	ssize_t n = ::write ( m_efd, &one, sizeof ( one ) );
+	( void ) n;
+      }
+
+    return true;
+  }
+
+  // Consumer thread only.
+  bool pop ( T& v )
+  {
+    size_t pos = m_head.load ( std::memory_order_relaxed );
+    Cell& c = m_cells[pos & m_mask];
+
+    if ( c.seq.load ( std::memory_order_acquire ) != pos + 1 )
+      return false;
+
+    v = std::move ( c.value );
+    c.seq.store ( pos + m_mask + 1, std::memory_order_release );
+    m_head.store ( pos + 1, std::memory_order_relaxed );
+
+    return true;
+  }
+
+  // Consumer thread, on waking and before popping: anything pushed from
+  // here on signals the eventfd again.
+  void clear_wakeup()
+  {
+    // The eventfd is reset before the flag, so a signal raised in
+    // between is not lost with it.
+    uint64_t n;
+    ssize_t r = ::read ( m_efd, &n, sizeof ( n ) );
+    ( void ) r;
+
+    m_signalled.store ( false, std::memory_order_relaxed );
+    std::atomic_thread_fence ( std::memory_order_seq_cst );
+  }
+
+  int fd() const { return m_efd; }
+  size_t capacity() const { return m_mask + 1; }
+
+ private:
+
+  HandoffQueue ( const HandoffQueue& );
+  HandoffQueue& operator = ( const HandoffQueue& );
+
+  struct alignas ( CACHE_LINE ) Cell
+  {
+    std::atomic<size_t> seq;
+    T value;
+  };
+
+  static size_t round_up ( size_t n )
+  {
+    size_t p = 2;
+    while ( p < n )
+      p <<= 1;
+    return p;
+  }
+
+  size_t m_mask;
+  std::unique_ptr<Cell[]> m_cells;
+  int m_efd;
+
+  // Producers and the consumer each get a line of their own.
+  alignas ( CACHE_LINE ) std::atomic<size_t> m_tail;
+  alignas ( CACHE_LINE ) std::atomic<size_t> m_head;
+  alignas ( CACHE_LINE ) std::atomic<bool> m_signalled;
+
+};
+
+
+#endif
@@ -0,0 +1,250 @@
+// Implementation of the HttpParser class
+
+#include "HttpParser.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+static char lower ( char c )
+{
+  return c >= 'A' && c <= 'Z' ? c + ( 'a' - 'A' ) : c;
+}
+
+
+static bool iequals ( std::string_view a, std::string_view b )
+{
+  if ( a.size() != b.size() )
+    return false;
+
+  for ( size_t i = 0; i < a.size(); i++ )
+    if ( lower ( a[i] ) != lower ( b[i] ) )
+      return false;
+
+  return true;
+}
+
+
+static std::string_view trim ( const char* p, const char* end )
+{
+  while ( p < end && ( *p == ' ' || *p == '\t' ) )
+    p++;
+  while ( end > p && ( end[-1] == ' ' || end[-1] == '\t' ) )
+    end--;
+
+  return std::string_view ( p, end - p );
+}
+
+
+// Does a comma separated list such as "keep-alive, Upgrade" hold token?
+static bool has_token ( std::string_view list, std::string_view token )
+{
+  while ( ! list.empty() )
+    {
+      size_t comma = list.find ( ',' );
+      std::string_view item = list.substr ( 0, comma );
+
+      if ( iequals ( trim ( item.data(), item.data() + item.size() ), token ) )
+	return true;
+
+      if ( comma == std::string_view::npos )
+	break;
+
+      list.remove_prefix ( comma + 1 );
+    }
+
+  return false;
+}
+
+
+std::string_view HttpRequest::header ( std::string_view name ) const
+{
+  for ( size_t i = 0; i < header_count; i++ )
+    if ( iequals ( headers[i].name, name ) )
+      return headers[i].value;
+
+  return std::string_view();
+}
+
+
+const char* HttpParser::find ( const char* p, const char* end, char c )
+{
+#ifdef __SSE2__
+  // Compare 16 bytes at once; the mask has a bit set for each match.
+  const __m128i needle = _mm_set1_epi8 ( c );
+
+  while ( end - p >= 16 )
+    {
+      __m128i chunk = _mm_loadu_si128 ( ( const __m128i* ) p );
+      int mask = _mm_movemask_epi8 ( _mm_cmpeq_epi8 ( chunk, needle ) );
+
+      if ( mask )
+	return p + __builtin_ctz ( mask );
+
+      p += 16;
+    }
+#endif
+
+  return find_bytewise ( p, end, c );
+}
+
+
+const char* HttpParser::find_bytewise ( const char* p, const char* end, char c )
+{
+  for ( ; p < end; p++ )
+    if ( *p == c )
+      return p;
+
+  return 0;
+}
+
+
+HttpParser::Status HttpParser::parse ( std::string_view buf, HttpRequest& req )
+{
+  // After an incomplete call, look only at the new bytes (less the three
+  // that could start a "\r\n\r\n") for the end of the head, and parse
+  // the lines once it is there.
+  if ( m_scanned > 0 )
+    {
+      const char* begin = buf.data();
+      const char* end = begin + buf.size();
+      const char* p = begin + ( m_scanned > 3 ? m_scanned - 3 : 0 );
+      bool found = false;
+
+      while ( ( p = scan ( p, end, '\n' ) ) )
+	{
+	  if ( ( p - begin >= 1 && p[-1] == '\n' ) || ( p - begin >= 2 && p[-1] == '\r' && p[-2] == '\n' ) )
+	    {
+	      found = true;
+	      break;
+	    }
+	  p++;
+	}
+
+      if ( ! found )
+	{
+	  m_scanned = buf.size();
+	  return m_scanned > HTTP_MAX_HEAD ? HTTP_TOO_LARGE : HTTP_INCOMPLETE;
+	}
+    }
+
+  Status s = parse_head ( buf, req );
+
+  if ( s == HTTP_INCOMPLETE )
+    {
+      m_scanned = buf.size();
+      if ( m_scanned > HTTP_MAX_HEAD )
+	return HTTP_TOO_LARGE;
+    }
+
+  return s;
+}
+
+
+HttpParser::Status HttpParser::parse_head ( std::string_view buf, HttpRequest& req )
+{
+  const char* begin = buf.data();
+  const char* end = begin + buf.size();
+  const char* p = begin;
+
+  req.header_count = 0;
+  req.content_length = 0;
+  req.chunked = false;
+
+  // Request line: method SP target SP HTTP/1.x
+  const char* eol = scan ( p, end, '\n' );
+
+  if ( ! eol )
+    return HTTP_INCOMPLETE;
+
+  const char* le = eol > p && eol[-1] == '\r' ? eol - 1 : eol;
+  const char* sp1 = scan ( p, le, ' ' );
+  const char* sp2 = sp1 ? scan ( sp1 + 1, le, ' ' ) : 0;
+
+  if ( ! sp1 || ! sp2 || sp1 == p || sp2 == sp1 + 1 )
+    return HTTP_ERROR;
+
+  std::string_view version ( sp2 + 1, le - sp2 - 1 );
+
+  if ( version.size() != 8 || version.compare ( 0, 7, "HTTP/1." ) != 0 || ( version[7] != '0' && version[7] != '1' ) )
+    return HTTP_ERROR;
+
+  req.method = std::string_view ( p, sp1 - p );
+  req.target = std::string_view ( sp1 + 1, sp2 - sp1 - 1 );
+  req.version = version[7] - '0';
+  req.keep_alive = req.version == 1;
+
+  bool have_length = false;
+  p = eol + 1;
+
+  // Header lines, up to the blank one.
+  while ( true )
+    {
+      if ( p - begin > ( ptrdiff_t ) HTTP_MAX_HEAD )
+	return HTTP_TOO_LARGE;
+
+      eol = scan ( p, end, '\n' );
+
+      if ( ! eol )
+	return HTTP_INCOMPLETE;
+
+      le = eol > p && eol[-1] == '\r' ? eol - 1 : eol;
+
+      if ( le == p )
+	break;
+
+      const char* colon = scan ( p, le, ':' );
+
+      // No obsolete line folding, and no space before the colon.
+      if ( ! colon || colon == p || *p == ' ' || *p == '\t' || colon[-1] == ' ' || colon[-1] == '\t' )
+	return HTTP_ERROR;
+
+      if ( req.header_count == HTTP_MAX_HEADERS )
+	return HTTP_TOO_LARGE;
+
+      HttpHeader& h = req.headers[req.header_count++];
+      h.name = std::string_view ( p, colon - p );
+      h.value = trim ( colon + 1, le );
+
+      if ( iequals ( h.name, "Content-Length" ) )
+	{
+	  size_t n = 0;
+
+	  if ( h.value.empty() || h.value.size() > 18 )
+	    return HTTP_ERROR;
+
+	  for ( char d : h.value )
+	    {
+	      if ( d < '0' || d > '9' )
+		return HTTP_ERROR;
+	      n = n * 10 + ( d - '0' );
+	    }
+
+	  // Conflicting lengths are how requests get smuggled.
+	  if ( have_length && n != req.content_length )
+	    return HTTP_ERROR;
+
+	  req.content_length = n;
+	  have_length = true;
+	}
+      else if ( iequals ( h.name, "Transfer-Encoding" ) )
+	req.chunked = req.chunked || has_token ( h.value, "chunked" );
+      else if ( iequals ( h.name, "Connection" ) )
+	{
+	  if ( has_token ( h.value, "close" ) )
+	    req.keep_alive = false;
+	  else if ( has_token ( h.value, "keep-alive" ) )
+	    req.keep_alive = true;
+	}
+
+      p = eol + 1;
+    }
+
+  if ( req.chunked && have_length )
+    return HTTP_ERROR;
+
+  m_consumed = eol + 1 - begin;
+
+  return HTTP_COMPLETE;
+}
@@ -0,0 +1,85 @@
+// Definition of the HttpParser class
+
+#ifndef HttpParser_class
+#define HttpParser_class
+
+#include <stddef.h>
+#include <string_view>
+
+
+const size_t HTTP_MAX_HEADERS = 32;
+const size_t HTTP_MAX_HEAD = 8 * 1024;
+
+struct HttpHeader
+{
+  std::string_view name;
+  std::string_view value;
+};
+
+// One request head. Every view points into the buffer that was parsed,
+// so a request is only good while that buffer is.
+struct HttpRequest
+{
+  std::string_view method;
+  std::string_view target;
+  int version;                 // minor version: 0 or 1
+  HttpHeader headers [ HTTP_MAX_HEADERS ];
+  size_t header_count;
+  size_t content_length;
+  bool chunked;
+  bool keep_alive;             // from the version and any Connection header
+
+  // The named header's value (case-insensitive), or an empty view.
+  std::string_view header ( std::string_view name ) const;
+};
+
+// An incremental HTTP/1.x request parser that works on raw receive
+// buffers and never allocates. Delimiters are found 16 bytes at a time
+// with SSE2 where available. parse() reports INCOMPLETE until the blank
+// line ending the head has arrived; calling again with the same bytes
+// plus more resumes the search where it stopped instead of rescanning.
+// Bodies are left to the caller, via content_length.
+class HttpParser
+{
+ public:
+
+  enum Status
+    {
+      HTTP_COMPLETE,
+      HTTP_INCOMPLETE,
+      HTTP_ERROR,              // malformed: answer 400 and close
+      HTTP_TOO_LARGE           // head over HTTP_MAX_HEAD or too many headers
+    };
+
+  // simd = false scans a byte at a time, for comparison.
+  HttpParser ( bool simd = true ) : m_scanned ( 0 ), m_consumed ( 0 ), m_simd ( simd ) {};
+
+  // buf must start at the beginning of a request. On HTTP_COMPLETE,
+  // consumed() is the length of the head.
+  Status parse ( std::string_view buf, HttpRequest& );
+
+  size_t consumed() const { return m_consumed; }
+
+  // Forgets a partial request, ready for the next one.
+  void reset() { m_scanned = m_consumed = 0; }
+
+  // The first c in [p, end), or 0.
+  static const char* find ( const char* p, const char* end, char c );
+  static const char* find_bytewise ( const char* p, const char* end, char c );
+
+ private:
+
+  Status parse_head ( std::string_view buf, HttpRequest& );
+  const char* scan ( const char* p, const char* end, char c ) const
+  {
+    return m_simd ? find ( p, end, c ) : find_bytewise ( p, end, c );
+  }
+
+  size_t m_scanned;    // bytes known not to hold the end of the head
+  size_t m_consumed;
+  bool m_simd;
+
+};
+
+
+#endif
@@ -0,0 +1,191 @@
+// Implementation of the HttpServer class
+
+#include "HttpServer.h"
+#include <algorithm>
+
+
+static const char* reason ( int status )
+{
+  switch ( status )
+    {
+    case 200: return "OK";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 431: return "Request Header Fields Too Large";
+    case 501: return "Not Implemented";
+    default: return "Error";
+    }
+}
+
+
+HttpServer::HttpServer ( ServerSocket& listener ) :
+  m_reactor ( listener, [this] ( ReactorServer::Connection& c, std::string_view data ) { on_data ( c, data ); } )
+{
+  m_reactor.on_close ( [this] ( ReactorServer::Connection& c ) { m_pending.destroy ( c.fd() ); } );
+
+  m_not_found = render ( 404, "not found\n", "text/plain" );
+  m_bad_method = render ( 405, "method not allowed\n", "text/plain" );
+  m_bad_request = render ( 400, "bad request\n", "text/plain" );
+  m_too_large = render ( 431, "request header too large\n", "text/plain" );
+  m_chunked = render ( 501, "chunked requests are not supported\n", "text/plain" );
+}
+
+
+std::string HttpServer::response ( int status, std::string_view body, const std::string& type, bool keep_alive )
+{
+  std::string r = "HTTP/1.1 " + std::to_string ( status ) + " " + reason ( status ) + "\r\n"
+    + "Content-Type: " + type + "\r\n"
+    + "Content-Length: " + std::to_string ( body.size() ) + "\r\n"
+    + ( keep_alive ? "Connection: keep-alive\r\n" : "Connection: close\r\n" )
+    + "\r\n";
+
+  r.append ( body );
+
+  return r;
+}
+
+
+HttpServer::Route HttpServer::render ( int status, std::string_view body, const std::string& type )
+{
+  Route r;
+
+  r.keep_alive = response ( status, body, type, true );
+  r.close = response ( status, body, type, false );
+  r.head = r.keep_alive.size() - body.size();
+  r.type = type;
+
+  return r;
+}
+
+
+void HttpServer::route ( const std::string& path, std::string_view body, const std::string& type )
+{
+  m_routes[path] = render ( 200, body, type );
+}
+
+
+void HttpServer::route ( const std::string& path, Generator body, const std::string& type )
+{
+  Route r;
+
+  r.head = 0;
+  r.generate = body;
+  r.type = type;
+
+  m_routes[path] = r;
+}
+
+
+void HttpServer::on_data ( ReactorServer::Connection& c, std::string_view data )
+{
+  Pending* p = m_pending.get ( c.fd() );
+
+  if ( ! p )
+    p = m_pending.create ( c.fd() );
+
+  // The rest of a body whose request has been answered.
+  size_t n = std::min ( p->skip, data.size() );
+  p->skip -= n;
+  data.remove_prefix ( n );
+
+  if ( data.empty() )
+    return;
+
+  // The usual case: whole requests, parsed where the reactor read them.
+  // Only a partial one at the end is copied out, to wait for the rest.
+  if ( p->buf.empty() )
+    {
+      size_t used = serve ( c, *p, data );
+      p->buf.assign ( data.substr ( used ) );
+    }
+  else
+    {
+      p->buf.append ( data );
+      size_t used = serve ( c, *p, p->buf );
+      p->buf.erase ( 0, used );
+    }
+}
+
+
+size_t HttpServer::serve ( ReactorServer::Connection& c, Pending& p, std::string_view buf )
+{
+  size_t pos = 0;
+  HttpRequest req;
+
+  while ( pos < buf.size() )
+    {
+      HttpParser::Status s = p.parser.parse ( buf.substr ( pos ), req );
+
+      if ( s == HttpParser::HTTP_INCOMPLETE )
+	break;
+
+      if ( s != HttpParser::HTTP_COMPLETE )
+	{
+	  refuse ( c, s == HttpParser::HTTP_TOO_LARGE ? m_too_large : m_bad_request );
+	  return buf.size();
+	}
+
+      pos += p.parser.consumed();
+      p.parser.reset();
+
+      if ( req.chunked )
+	{
+	  refuse ( c, m_chunked );
+	  return buf.size();
+	}
+
+      if ( ! respond ( c, req ) )
+	return buf.size();
+
+      // Bodies are not wanted; what has not arrived yet is skipped later.
+      size_t body = std::min ( req.content_length, buf.size() - pos );
+      pos += body;
+      p.skip = req.content_length - body;
+    }
+
+  return pos;
+}
+
+
+bool HttpServer::respond ( ReactorServer::Connection& c, const HttpRequest& req )
+{
+  bool head = req.method == "HEAD";
+
+  if ( ! head && req.method != "GET" )
+    {
+      refuse ( c, m_bad_method );
+      return false;
+    }
+
+  std::string_view path = req.target.substr ( 0, req.target.find ( '?' ) );
+  auto it = m_routes.find ( path );
+  const Route& r = it == m_routes.end() ? m_not_found : it->second;
+
+  if ( r.generate )
+    {
+      std::string body = r.generate();
+      std::string out = response ( 200, body, r.type, req.keep_alive );
+      c.send ( head ? std::string_view ( out ).substr ( 0, out.size() - body.size() ) : out );
+    }
+  else
+    {
+      std::string_view out = req.keep_alive ? r.keep_alive : r.close;
+      size_t body = r.keep_alive.size() - r.head;
+      c.send ( head ? out.substr ( 0, out.size() - body ) : out );
+    }
+
+  if ( ! req.keep_alive )
+    c.close();
+
+  return req.keep_alive;
+}
+
+
+void HttpServer::refuse ( ReactorServer::Connection& c, const Route& r )
+{
+  // After a request we could not frame, nothing that follows can be
+  // trusted to start a request, so the connection goes.
+  c.send ( r.close );
+  c.close();
+}
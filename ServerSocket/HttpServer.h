@@ -0,0 +1,87 @@
+// Definition of the HttpServer class
+
+#ifndef HttpServer_class
+#define HttpServer_class
+
+#include "ReactorServer.h"
+#include "HttpParser.h"
+#include "Slab.h"
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+
+
+// A keep-alive HTTP/1.1 server on a ReactorServer, for health checks,
+// metrics and other small fixed answers. Requests are parsed straight
+// out of the reactor's read buffer; only a request split across reads is
+// copied, into a per-connection buffer. Static routes are rendered into
+// complete responses once, when added, so answering one is a single
+// copy into the write queue, and a pipelined batch goes out in one write.
+// GET and HEAD are served; request bodies are read and discarded, and
+// chunked bodies are refused with 501.
+class HttpServer
+{
+ public:
+
+  typedef std::function<std::string ()> Generator;
+
+  HttpServer ( ServerSocket& listener );
+  virtual ~HttpServer() {};
+
+  // A fixed body, rendered into a response now.
+  void route ( const std::string& path, std::string_view body, const std::string& type = "text/plain" );
+
+  // A body built afresh for each request.
+  void route ( const std::string& path, Generator body, const std::string& type = "text/plain" );
+
+  void run() { m_reactor.run(); }
+  void stop() { m_reactor.stop(); }
+
+  ReactorServer& reactor() { return m_reactor; }
+
+ private:
+
+  HttpServer ( const HttpServer& );
+  HttpServer& operator = ( const HttpServer& );
+
+  struct Route
+  {
+    std::string keep_alive;   // complete responses, by Connection header
+    std::string close;
+    size_t head;              // length of the head alone, for HEAD
+    Generator generate;
+    std::string type;
+  };
+
+  // A connection's unfinished business between reads.
+  struct Pending
+  {
+    std::string buf;          // the start of a request split across reads
+    HttpParser parser;
+    size_t skip;              // body bytes still to discard
+    Pending() : skip ( 0 ) {};
+  };
+
+  static Route render ( int status, std::string_view body, const std::string& type );
+  static std::string response ( int status, std::string_view body, const std::string& type, bool keep_alive );
+
+  void on_data ( ReactorServer::Connection&, std::string_view );
+  size_t serve ( ReactorServer::Connection&, Pending&, std::string_view );
+  bool respond ( ReactorServer::Connection&, const HttpRequest& );
+  void refuse ( ReactorServer::Connection&, const Route& );
+
+  ReactorServer m_reactor;
+  Slab<Pending> m_pending;
+  std::map<std::string, Route, std::less<> > m_routes;
+
+  Route m_not_found;
+  Route m_bad_method;
+  Route m_bad_request;
+  Route m_too_large;
+  Route m_chunked;
+
+};
+
+
+#endif
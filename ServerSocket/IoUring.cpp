@@ -0,0 +1,159 @@
+// Implementation of the IoUring class
+
+#include "IoUring.h"
+#include "SocketException.h"
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <algorithm>
+
+
+IoUring::IoUring ( unsigned entries ) :
+  m_fd ( -1 ),
+  m_ring ( MAP_FAILED ),
+  m_ring_size ( 0 ),
+  m_sqes ( ( io_uring_sqe* ) MAP_FAILED ),
+  m_sqes_size ( 0 ),
+  m_sq_local_tail ( 0 ),
+  m_sq_flushed ( 0 )
+{
+  io_uring_params p;
+  memset ( &p, 0, sizeof ( p ) );
+
+  // Multishot operations post several completions per submission.
+  p.flags = IORING_SETUP_CQSIZE;
+  p.cq_entries = entries * 4;
+
+  m_fd = syscall ( __NR_io_uring_setup, entries, &p );
+
+  if ( m_fd == -1 )
+    {
+      throw SocketException ( "Could not set up io_uring." );
+    }
+
+  if ( ! ( p.features & IORING_FEAT_SINGLE_MMAP ) )
+    {
+      ::close ( m_fd );
+      throw SocketException ( "io_uring is too old." );
+    }
+
+  m_ring_size = std::max ( p.sq_off.array + p.sq_entries * sizeof ( unsigned ),
+			   p.cq_off.cqes + p.cq_entries * sizeof ( io_uring_cqe ) );
+  m_ring = mmap ( 0, m_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+		  m_fd, IORING_OFF_SQ_RING );
+
+  m_sqes_size = p.sq_entries * sizeof ( io_uring_sqe );
+  m_sqes = ( io_uring_sqe* ) mmap ( 0, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+				    m_fd, IORING_OFF_SQES );
+
+  if ( m_ring == MAP_FAILED || m_sqes == MAP_FAILED )
+    {
+      if ( m_ring != MAP_FAILED )
+	munmap ( m_ring, m_ring_size );
+      if ( m_sqes != MAP_FAILED )
+	munmap ( m_sqes, m_sqes_size );
+      ::close ( m_fd );
+      throw SocketException ( "Could not map io_uring." );
+    }
+
+  char* ring = ( char* ) m_ring;
+
+  m_sq_head = ( unsigned* ) ( ring + p.sq_off.head );
+  m_sq_tail = ( unsigned* ) ( ring + p.sq_off.tail );
+  m_sq_mask = *( unsigned* ) ( ring + p.sq_off.ring_mask );
+  m_sq_entries = p.sq_entries;
+
+  // Submission slots are used in order, so the index array is the identity.
+  unsigned* array = ( unsigned* ) ( ring + p.sq_off.array );
+  for ( unsigned i = 0; i < m_sq_entries; i++ )
+    array[i] = i;
+
+  m_sq_local_tail = m_sq_flushed = *m_sq_tail;
+
+  m_cq_head = ( unsigned* ) ( ring + p.cq_off.head );
+  m_cq_tail = ( unsigned* ) ( ring + p.cq_off.tail );
+  m_cq_mask = *( unsigned* ) ( ring + p.cq_off.ring_mask );
+  m_cqes = ( io_uring_cqe* ) ( ring + p.cq_off.cqes );
+}
+
+IoUring::~IoUring()
+{
+  munmap ( m_sqes, m_sqes_size );
+  munmap ( m_ring, m_ring_size );
+  ::close ( m_fd );
+}
+
+
+io_uring_sqe* IoUring::get_sqe()
+{
+  unsigned head = __atomic_load_n ( m_sq_head, __ATOMIC_ACQUIRE );
+
+  if ( m_sq_local_tail - head >= m_sq_entries )
+    {
+      submit();
+      head = __atomic_load_n ( m_sq_head, __ATOMIC_ACQUIRE );
+
+      if ( m_sq_local_tail - head >= m_sq_entries )
+	return 0;
+    }
+
+  io_uring_sqe* sqe = &m_sqes[m_sq_local_tail & m_sq_mask];
+  memset ( sqe, 0, sizeof ( *sqe ) );
+  m_sq_local_tail++;
+
+  return sqe;
+}
+
+
+int IoUring::submit ( unsigned wait_nr )
+{
+  __atomic_store_n ( m_sq_tail, m_sq_local_tail, __ATOMIC_RELEASE );
+
+  unsigned to_submit = m_sq_local_tail - m_sq_flushed;
+  unsigned flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+
+  if ( to_submit == 0 && wait_nr == 0 )
+    return 0;
+
+  int status;
+
+  do
+    status = syscall ( __NR_io_uring_enter, m_fd, to_submit, wait_nr, flags, 0, 0 );
+  while ( status == -1 && errno == EINTR && wait_nr == 0 );
+
+  if ( status > 0 )
+    m_sq_flushed += status;
+
+  return status;
+}
+
+
+io_uring_cqe* IoUring::peek_cqe()
+{
+  unsigned head = *m_cq_head;
+
+  if ( head == __atomic_load_n ( m_cq_tail, __ATOMIC_ACQUIRE ) )
+    return 0;
+
+  return &m_cqes[head & m_cq_mask];
+}
+
+
+void IoUring::cqe_seen()
+{
+  __atomic_store_n ( m_cq_head, *m_cq_head + 1, __ATOMIC_RELEASE );
+}
+
+
+bool IoUring::register_buffer_ring ( void* ring, unsigned entries, unsigned short group )
+{
+  io_uring_buf_reg reg;
+  memset ( &reg, 0, sizeof ( reg ) );
+  reg.ring_addr = ( unsigned long ) ring;
+  reg.ring_entries = entries;
+  reg.bgid = group;
+
+  return syscall ( __NR_io_uring_register, m_fd, IORING_REGISTER_PBUF_RING, &reg, 1 ) == 0;
+}
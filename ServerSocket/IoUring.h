@@ -0,0 +1,63 @@
+// Definition of the IoUring class
+
+#ifndef IoUring_class
+#define IoUring_class
+
+#include <linux/io_uring.h>
+#include <stddef.h>
+
+
+// Minimal io_uring instance driven through the raw system calls, so no
+// liburing is needed. Submission entries are queued with get_sqe() and
+// handed to the kernel in one io_uring_enter by submit().
+class IoUring
+{
+ public:
+
+  IoUring ( unsigned entries );
+  virtual ~IoUring();
+
+  // A zeroed submission entry, or 0 when the queue is still full after
+  // flushing it to the kernel.
+  io_uring_sqe* get_sqe();
+
+  // Submit everything queued and wait for at least wait_nr completions.
+  int submit ( unsigned wait_nr = 0 );
+
+  // The next completion, or 0 if none is ready; mark it consumed with
+  // cqe_seen() once done with it.
+  io_uring_cqe* peek_cqe();
+  void cqe_seen();
+
+  bool register_buffer_ring ( void* ring, unsigned entries, unsigned short group );
+
+  int fd() const { return m_fd; }
+
+ private:
+
+  IoUring ( const IoUring& );
+  IoUring& operator = ( const IoUring& );
+
+  int m_fd;
+
+  void* m_ring;
+  size_t m_ring_size;
+  io_uring_sqe* m_sqes;
+  size_t m_sqes_size;
+
+  unsigned* m_sq_head;
+  unsigned* m_sq_tail;
+  unsigned m_sq_mask;
+  unsigned m_sq_entries;
+  unsigned m_sq_local_tail;   // entries handed out by get_sqe()
+  unsigned m_sq_flushed;      // entries already passed to io_uring_enter
+
+  unsigned* m_cq_head;
+  unsigned* m_cq_tail;
+  unsigned m_cq_mask;
+  io_uring_cqe* m_cqes;
+
+};
+
+
+#endif
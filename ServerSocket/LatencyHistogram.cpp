@@ -0,0 +1,105 @@
+// Implementation of the LatencyHistogram class
+
+#include "LatencyHistogram.h"
+#include <algorithm>
+
+
+LatencyHistogram::LatencyHistogram() :
+  m_buckets ( HISTOGRAM_BUCKETS ),
+  m_count ( 0 ),
+  m_sum ( 0 ),
+  m_max ( 0 )
+{
+}
+
+
+size_t LatencyHistogram::bucket ( uint64_t value )
+{
+  if ( value < HISTOGRAM_LINEAR )
+    return value;
+
+  int msb = 63 - __builtin_clzll ( value );
+  uint64_t top = value >> ( msb - 4 );
+
+  return HISTOGRAM_LINEAR + ( msb - 5 ) * HISTOGRAM_SUB + ( top - HISTOGRAM_SUB );
+}
+
+
+uint64_t LatencyHistogram::bucket_value ( size_t bucket )
+{
+  if ( bucket < HISTOGRAM_LINEAR )
+    return bucket;
+
+  size_t msb = ( bucket - HISTOGRAM_LINEAR ) / HISTOGRAM_SUB + 5;
+  uint64_t top = ( bucket - HISTOGRAM_LINEAR ) % HISTOGRAM_SUB + HISTOGRAM_SUB;
+
+  // Report the middle of the bucket.
+  return ( top << ( msb - 4 ) ) + ( ( uint64_t ) 1 << ( msb - 5 ) );
+}
+
+
+void LatencyHistogram::record ( uint64_t value )
+{
+  m_buckets[bucket ( value )]++;
+  m_count++;
+  m_sum += value;
+
+  if ( value > m_max )
+    m_max = value;
+}
+
+
+void LatencyHistogram::record ( uint64_t value, uint64_t count )
+{
+  if ( count == 0 )
+    return;
+
+  m_buckets[bucket ( value )] += count;
+  m_count += count;
+  m_sum += value * count;
+
+  if ( value > m_max )
+    m_max = value;
+}
+
+
+void LatencyHistogram::merge ( const LatencyHistogram& other )
+{
+  for ( size_t i = 0; i < m_buckets.size(); i++ )
+    m_buckets[i] += other.m_buckets[i];
+
+  m_count += other.m_count;
+  m_sum += other.m_sum;
+
+  if ( other.m_max > m_max )
+    m_max = other.m_max;
+}
+
+
+void LatencyHistogram::reset()
+{
+  m_buckets.assign ( m_buckets.size(), 0 );
+  m_count = m_sum = m_max = 0;
+}
+
+
+uint64_t LatencyHistogram::percentile ( double fraction ) const
+{
+  if ( m_count == 0 )
+    return 0;
+
+  uint64_t rank = ( uint64_t ) ( fraction * m_count );
+  if ( rank >= m_count )
+    rank = m_count - 1;
+
+  uint64_t seen = 0;
+
+  for ( size_t i = 0; i < m_buckets.size(); i++ )
+    {
+      seen += m_buckets[i];
+      if ( seen > rank )
+	return std::min ( bucket_value ( i ), m_max );
+    }
+
+  return m_max;
+}
@@ -0,0 +1,55 @@
+// Definition of the LatencyHistogram class
+
+#ifndef LatencyHistogram_class
+#define LatencyHistogram_class
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+
+// Values below 32 get a bucket each; above that every power of two gets
+// 16 buckets, indexed by the 4 bits after the most significant one.
+const size_t HISTOGRAM_LINEAR = 32;
+const size_t HISTOGRAM_SUB = 16;
+const size_t HISTOGRAM_BUCKETS = HISTOGRAM_LINEAR + ( 64 - 5 ) * HISTOGRAM_SUB;
+
+// Log-linear histogram of non-negative values (nanoseconds, typically).
+// Each power of two is split into 16 buckets, so any reported percentile
+// is within about 6% of the true value, in constant memory and with an
+// O(1) record().
+class LatencyHistogram
+{
+ public:
+
+  LatencyHistogram();
+
+  void record ( uint64_t value );
+
+  // count samples of the same value at once, for rebuilding a histogram
+  // from bucket counts kept elsewhere.
+  void record ( uint64_t value, uint64_t count );
+  void merge ( const LatencyHistogram& );
+  void reset();
+
+  // The value below which the given fraction (0..1) of samples fall.
+  uint64_t percentile ( double fraction ) const;
+
+  uint64_t count() const { return m_count; }
+  uint64_t max() const { return m_max; }
+  double mean() const { return m_count ? ( double ) m_sum / m_count : 0; }
+
+  static size_t bucket ( uint64_t value );
+  static uint64_t bucket_value ( size_t bucket );
+
+ private:
+
+  std::vector<uint64_t> m_buckets;
+  uint64_t m_count;
+  uint64_t m_sum;
+  uint64_t m_max;
+
+};
+
+
+#endif
@@ -0,0 +1,66 @@
+// Implementation of the MetricsEndpoint class
+
+#include "MetricsEndpoint.h"
+#include "SocketMetrics.h"
+#include <poll.h>
+#include <sys/socket.h>
+#include <chrono>
+
+
+const int METRICS_REQUEST_TIMEOUT_MS = 1000;
+
+
+MetricsEndpoint::MetricsEndpoint ( const std::string& path ) :
+  m_listener ( path ),
+  m_stop ( false )
+{
+  m_thread = std::thread ( &MetricsEndpoint::serve, this );
+}
+
+MetricsEndpoint::~MetricsEndpoint()
+{
+  // Shutting the listener down wakes the blocked accept.
+  m_stop = true;
+  ::shutdown ( m_listener.fd(), SHUT_RDWR );
+  m_thread.join();
+}
+
+
+void MetricsEndpoint::serve()
+{
+  while ( ! m_stop )
+    {
+      SocketResult<ServerSocket> conn = m_listener.try_accept();
+
+      if ( conn )
+	answer ( *conn );
+      else if ( ! m_stop && ! accept_retry_now ( conn.error() ) )
+	std::this_thread::sleep_for ( std::chrono::milliseconds ( ACCEPT_BACKOFF_MS ) );
+    }
+}
+
+
+void MetricsEndpoint::answer ( ServerSocket& conn )
+{
+  // A client that never sends anything must not wedge the endpoint.
+  pollfd pfd = { conn.fd(), POLLIN, 0 };
+  if ( ::poll ( &pfd, 1, METRICS_REQUEST_TIMEOUT_MS ) <= 0 )
+    return;
+
+  std::string request;
+  if ( ! conn.try_recv ( request ) )
+    return;
+
+  bool json = request.find ( "json" ) != std::string::npos;
+  std::string body = json ? SocketMetrics::json() : SocketMetrics::text();
+
+  if ( request.compare ( 0, 4, "GET " ) == 0 )
+    {
+      std::string header = std::string ( "HTTP/1.0 200 OK\r\nContent-Type: " )
+	+ ( json ? "application/json" : "text/plain" )
+	+ "\r\nContent-Length: " + std::to_string ( body.size() ) + "\r\n\r\n";
+      conn.try_send ( { header, body } );
+    }
+  else
+    conn.try_send ( body );
+}
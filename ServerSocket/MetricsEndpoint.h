@@ -0,0 +1,40 @@
+// Definition of the MetricsEndpoint class
+
+#ifndef MetricsEndpoint_class
+#define MetricsEndpoint_class
+
+#include "ServerSocket.h"
+#include <atomic>
+#include <string>
+#include <thread>
+
+
+// Serves SocketMetrics on a local (AF_UNIX) socket from its own thread.
+// A client connects, sends one request and reads until close: a request
+// mentioning "json" gets SocketMetrics::json(), anything else text().
+// HTTP requests are answered as HTTP, so
+//   curl --unix-socket /tmp/admin.sock http://localhost/metrics.json
+// works too. Its own connections show up in the counters like any other.
+class MetricsEndpoint
+{
+ public:
+
+  MetricsEndpoint ( const std::string& path );
+  virtual ~MetricsEndpoint();
+
+ private:
+
+  MetricsEndpoint ( const MetricsEndpoint& );
+  MetricsEndpoint& operator = ( const MetricsEndpoint& );
+
+  void serve();
+  void answer ( ServerSocket& );
+
+  ServerSocket m_listener;
+  std::atomic<bool> m_stop;
+  std::thread m_thread;
+
+};
+
+
+#endif
@@ -0,0 +1,266 @@
+// Implementation of the ReactorServer class
+
+#include "ReactorServer.h"
+#include "SocketException.h"
+#include <errno.h>
+
+
+const size_t READSIZE = 64 * 1024;
+
+
+bool ReactorServer::Connection::send ( std::string_view s )
+{
+  if ( m_closing || s.empty() )
+    return ! m_out.above_high_watermark();
+
+  if ( m_out.empty() )
+    m_server.m_dirty.push_back ( fd() );
+
+  return m_out.push ( s );
+}
+
+
+bool ReactorServer::Connection::send ( SharedBuffer* b )
+{
+  if ( m_closing || b->size() == 0 )
+    return ! m_out.above_high_watermark();
+
+  if ( m_out.empty() )
+    m_server.m_dirty.push_back ( fd() );
+
+  return m_out.push ( b );
+}
+
+
+void ReactorServer::Connection::close()
+{
+  if ( m_closing )
+    return;
+
+  // Nothing more is read, so a peer that keeps sending cannot keep a
+  // level-triggered loop spinning while the output drains.
+  m_closing = true;
+  m_server.m_loop.set_read_interest ( fd(), false );
+  m_server.m_dirty.push_back ( fd() );
+}
+
+
+void ReactorServer::Connection::abort()
+{
+  // With the queue empty the next flush closes straight away, even for
+  // a connection already closing and waiting on a peer that never reads.
+  if ( ! m_closing )
+    m_server.m_loop.set_read_interest ( fd(), false );
+
+  m_closing = true;
+  m_out.clear();
+  m_server.m_dirty.push_back ( fd() );
+}
+
+
+void ReactorServer::Connection::set_read_deadline ( uint64_t ms )
+{
+  if ( ms )
+    m_server.m_loop.timers().arm ( m_read_timer, ms );
+  else
+    m_read_timer.cancel();
+}
+
+
+ReactorServer::ReactorServer ( ServerSocket& listener, DataHandler handler ) :
+  m_listener ( listener ),
+  m_handler ( handler ),
+  m_running ( false ),
+  m_low ( WRITE_LOW_WATERMARK ),
+  m_high ( WRITE_HIGH_WATERMARK ),
+  m_idle_ms ( 0 ),
+  m_read_ms ( 0 ),
+  m_write_ms ( 0 ),
+  m_profile ( 0 ),
+  m_buffers ( WRITE_CHUNK ),
+  m_buf ( READSIZE )
+{
+  m_listener.set_non_blocking ( true );
+
+  if ( ! m_loop.add ( m_listener.fd(), [this] { on_accept(); } ) )
+    {
+      throw SocketException ( "Could not watch listening socket." );
+    }
+
+  m_accept_timer.set_callback ( [this] { m_loop.set_read_interest ( m_listener.fd(), true ); } );
+}
+
+ReactorServer::~ReactorServer()
+{
+  m_loop.remove ( m_listener.fd() );
+
+  m_conns.for_each ( [this] ( int fd, Connection& ) { m_loop.remove ( fd ); } );
+}
+
+
+void ReactorServer::set_timeouts ( uint64_t idle_ms, uint64_t read_ms, uint64_t write_ms )
+{
+  m_idle_ms = idle_ms;
+  m_read_ms = read_ms;
+  m_write_ms = write_ms;
+}
+
+
+void ReactorServer::run()
+{
+  m_running = true;
+
+  while ( m_running )
+    {
+      m_loop.run_once();
+
+      // Replies from the whole batch go out together, one write each.
+      // Both lists keep their capacity from one batch to the next.
+      m_flushing.swap ( m_dirty );
+
+      for ( size_t i = 0; i < m_flushing.size(); i++ )
+	{
+	  Connection* c = m_conns.get ( m_flushing[i] );
+	  if ( c )
+	    flush ( *c );
+	}
+
+      m_flushing.clear();
+    }
+}
+
+
+void ReactorServer::on_accept()
+{
+  // Drain every pending connection on each wakeup, so a burst is taken in
+  // one pass rather than one epoll round trip per connection.
+  while ( true )
+    {
+      SocketResult<ServerSocket> sock = m_listener.try_accept ( true );
+
+      if ( ! sock && accept_retry_now ( sock.error() ) )
+	continue;
+
+      if ( ! sock )
+	{
+	  // Out of descriptors or memory, the listener stays readable:
+	  // stop watching it for a while rather than spin.
+	  if ( sock.error() != EAGAIN && sock.error() != EWOULDBLOCK )
+	    pause_accepting();
+	  return;
+	}
+
+      int fd = sock->fd();
+      Connection* c = m_conns.create ( fd, *this );
+      c->m_sock = std::move ( *sock );
+
+      if ( m_profile )
+	c->m_sock.try_set_profile ( m_profile );
+
+      // Backpressure: stop reading from a peer whose replies pile up.
+      c->m_out.set_watermarks ( m_low, m_high );
+      c->m_out.on_high_watermark ( [this, fd] { m_loop.set_read_interest ( fd, false ); } );
+      c->m_out.on_low_watermark ( [this, fd] {
+	  if ( ! m_conns.get ( fd )->m_closing )
+	    m_loop.set_read_interest ( fd, true );
+	  if ( m_on_drain )
+	    m_on_drain ( *m_conns.get ( fd ) );
+	} );
+
+      if ( ! m_loop.add ( fd, [this, fd] { on_read ( fd ); }, [this, fd] { on_write ( fd ); } ) )
+	{
+	  m_conns.destroy ( fd );
+	  continue;
+	}
+
+      c->m_idle_timer.set_callback ( [this, fd] { close ( fd ); } );
+      c->m_read_timer.set_callback ( [this, fd] { close ( fd ); } );
+      c->m_write_timer.set_callback ( [this, fd] { close ( fd ); } );
+
+      if ( m_idle_ms )
+	m_loop.timers().arm ( c->m_idle_timer, m_idle_ms );
+      if ( m_read_ms )
+	c->set_read_deadline ( m_read_ms );
+    }
+}
+
+
+void ReactorServer::pause_accepting()
+{
+  m_loop.set_read_interest ( m_listener.fd(), false );
+  m_loop.timers().arm ( m_accept_timer, ACCEPT_BACKOFF_MS );
+}
+
+
+void ReactorServer::on_read ( int fd )
+{
+  Connection& c = *m_conns.get ( fd );
+
+  while ( ! c.m_closing && ! c.m_out.above_high_watermark() )
+    {
+      ssize_t n = c.m_sock.read_some ( &m_buf[0], m_buf.size() );
+
+      if ( n == -1 && ( errno == EAGAIN || errno == EWOULDBLOCK ) )
+	return;
+
+      if ( n <= 0 )
+	{
+	  close ( fd );
+	  return;
+	}
+
+      c.m_read_timer.cancel();
+      if ( m_idle_ms )
+	m_loop.timers().arm ( c.m_idle_timer, m_idle_ms );
+
+      m_handler ( c, std::string_view ( &m_buf[0], n ) );
+    }
+}
+
+
+void ReactorServer::on_write ( int fd )
+{
+  flush ( *m_conns.get ( fd ) );
+}
+
+
+void ReactorServer::flush ( Connection& c )
+{
+  int fd = c.fd();
+  size_t before = c.m_out.size();
+
+  if ( ! c.m_out.flush ( c.m_sock ) )
+    {
+      close ( fd );
+      return;
+    }
+
+  // The write timeout only runs while output is stuck; any progress
+  // restarts it, as it does the idle timeout.
+  bool progress = c.m_out.size() < before;
+
+  if ( progress && m_idle_ms )
+    m_loop.timers().arm ( c.m_idle_timer, m_idle_ms );
+
+  if ( c.m_out.empty() )
+    c.m_write_timer.cancel();
+  else if ( m_write_ms && ( progress || ! c.m_write_timer.armed() ) )
+    m_loop.timers().arm ( c.m_write_timer, m_write_ms );
+
+  m_loop.set_write_interest ( fd, ! c.m_out.empty() );
+
+  if ( c.m_closing && c.m_out.empty() )
+    close ( fd );
+}
+
+
+void ReactorServer::close ( int fd )
+{
+  Connection* c = m_conns.get ( fd );
+
+  if ( c && m_on_close )
+    m_on_close ( *c );
+
+  m_loop.remove ( fd );
+  m_conns.destroy ( fd );
+}
@@ -0,0 +1,141 @@
+// Definition of the ReactorServer class
+
+#ifndef ReactorServer_class
+#define ReactorServer_class
+
+#include "ServerSocket.h"
+#include "EventLoop.h"
+#include "BufferPool.h"
+#include "Slab.h"
+#include "WriteQueue.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+// Serves every connection accepted on a listener from one EventLoop. The
+// data handler sees each chunk as it is read; replies queued with
+// Connection::send are flushed once the current batch of events is done.
+// A connection whose write queue passes the high watermark stops being
+// read until it drains below the low one. Optional idle, read and write
+// timeouts close connections that stall, using the loop's timer wheel.
+// Connections live in a Slab indexed by descriptor and their output in
+// pooled chunks, so accepting and closing under churn does not malloc.
+class ReactorServer
+{
+ public:
+
+  class Connection
+  {
+   public:
+
+    // Returns false while the write queue is above its high watermark.
+    bool send ( std::string_view );
+
+    // Queues a reference instead of a copy, for one message sent to many.
+    bool send ( SharedBuffer* );
+
+    void close();
+
+    // Closes without waiting for queued output, which is discarded, e.g.
+    // for a peer that has stopped reading.
+    void abort();
+
+    // Closes the connection unless more data arrives within ms, e.g.
+    // while a message is half received. Cleared by any data; 0 clears it.
+    void set_read_deadline ( uint64_t ms );
+
+    size_t queued() const { return m_out.size(); }
+
+    // Above the high watermark, and not yet drained below the low one.
+    bool backlogged() const { return m_out.above_high_watermark(); }
+
+    int fd() const { return m_sock.fd(); }
+
+   private:
+
+    friend class ReactorServer;
+    friend class Slab<Connection>;
+
+    Connection ( ReactorServer& server ) : m_server ( server ), m_out ( server.m_buffers ), m_closing ( false ) {};
+
+    ReactorServer& m_server;
+    ServerSocket m_sock;
+    WriteQueue m_out;   // bytes not yet accepted by the kernel
+    bool m_closing;
+
+    TimerWheel::Timer m_idle_timer;
+    TimerWheel::Timer m_read_timer;
+    TimerWheel::Timer m_write_timer;
+
+  };
+
+  typedef std::function<void ( Connection&, std::string_view )> DataHandler;
+  typedef std::function<void ( Connection& )> CloseHandler;
+
+  ReactorServer ( ServerSocket& listener, DataHandler handler );
+  virtual ~ReactorServer();
+
+  void run();
+  void stop() { m_running = false; m_loop.stop(); }
+
+  // Applies to connections accepted from now on.
+  void set_watermarks ( size_t low, size_t high ) { m_low = low; m_high = high; }
+
+  // In milliseconds, 0 for none; apply to connections accepted from now
+  // on. idle: no bytes moved either way. read: a new connection sends
+  // nothing. write: queued output that the peer stops accepting.
+  void set_timeouts ( uint64_t idle_ms, uint64_t read_ms, uint64_t write_ms );
+
+  // SocketProfile options for connections accepted from now on, as far
+  // as the socket supports them (local sockets have no TCP options).
+  void set_profile ( int profiles ) { m_profile = profiles; }
+
+  // Called as each connection goes, for any state kept beside it.
+  void on_close ( CloseHandler h ) { m_on_close = h; }
+
+  // Called when a backlogged connection drains below the low watermark.
+  void on_drain ( CloseHandler h ) { m_on_drain = h; }
+
+  EventLoop& loop() { return m_loop; }
+  size_t connections() const { return m_conns.size(); }
+  const BufferPool& buffers() const { return m_buffers; }
+
+ private:
+
+  ReactorServer ( const ReactorServer& );
+  ReactorServer& operator = ( const ReactorServer& );
+
+  void on_accept();
+  void pause_accepting();
+  void on_read ( int fd );
+  void on_write ( int fd );
+  void flush ( Connection& );
+  void close ( int fd );
+
+  ServerSocket& m_listener;
+  DataHandler m_handler;
+  CloseHandler m_on_close;
+  CloseHandler m_on_drain;
+  EventLoop m_loop;
+  TimerWheel::Timer m_accept_timer;   // resumes accepting after a backoff
+  bool m_running;
+  size_t m_low;
+  size_t m_high;
+  uint64_t m_idle_ms;
+  uint64_t m_read_ms;
+  uint64_t m_write_ms;
+  int m_profile;
+
+  BufferPool m_buffers;
+  Slab<Connection> m_conns;
+  std::vector<int> m_dirty;   // connections with output queued this batch
+  std::vector<int> m_flushing;
+  std::vector<char> m_buf;
+
+};
+
+
+#endif
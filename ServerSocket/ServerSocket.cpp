@@ -4,21 +4,47 @@
 #include "SocketException.h"
 
 
-ServerSocket::ServerSocket ( int port )
+ServerSocket::ServerSocket ( int port, bool reuse_port, int backlog )
 {
-  if ( ! Socket::create() )
+  SocketResult<void> r = Socket::create();
+  if ( ! r )
     {
-      throw SocketException ( "Could not create server socket." );
+      throw SocketException ( "Could not create server socket.", r.error() );
     }
 
-  if ( ! Socket::bind ( port ) )
+  if ( reuse_port && ! ( r = Socket::set_reuse_port() ) )
     {
-      throw SocketException ( "Could not bind to port." );
+      throw SocketException ( "Could not set SO_REUSEPORT.", r.error() );
     }
 
-  if ( ! Socket::listen() )
+  if ( ! ( r = Socket::bind ( port ) ) )
     {
-      throw SocketException ( "Could not listen to socket." );
+      throw SocketException ( "Could not bind to port.", r.error() );
+    }
+
+  if ( ! ( r = Socket::listen ( backlog ) ) )
+    {
+      throw SocketException ( "Could not listen to socket.", r.error() );
+    }
+
+}
+
+ServerSocket::ServerSocket ( const std::string& path, int backlog )
+{
+  SocketResult<void> r = Socket::create_local();
+  if ( ! r )
+    {
+      throw SocketException ( "Could not create server socket.", r.error() );
+    }
+
+  if ( ! ( r = Socket::bind_local ( path ) ) )
+    {
+      throw SocketException ( "Could not bind to path.", r.error() );
+    }
+
+  if ( ! ( r = Socket::listen ( backlog ) ) )
+    {
+      throw SocketException ( "Could not listen to socket.", r.error() );
     }
 
 }
@@ -28,11 +54,12 @@ ServerSocket::~ServerSocket()
 }
 
 
-const ServerSocket& ServerSocket::operator << ( const std::string& s ) const
+const ServerSocket& ServerSocket::operator << ( std::string_view s ) const
 {
-  if ( ! Socket::send ( s ) )
+  SocketResult<void> r = try_send ( s );
+  if ( ! r )
     {
-      throw SocketException ( "Could not write to socket." );
+      throw SocketException ( "Could not write to socket.", r.error() );
     }
 
   return *this;
@@ -42,18 +69,209 @@ const ServerSocket& ServerSocket::operator << ( const std::string& s ) const
 
 const ServerSocket& ServerSocket::operator >> ( std::string& s ) const
 {
-  if ( ! Socket::recv ( s ) )
+  SocketResult<size_t> r = try_recv ( s );
+  if ( ! r || *r == 0 )
     {
-      throw SocketException ( "Could not read from socket." );
+      throw SocketException ( "Could not read from socket.", r.error() );
     }
 
   return *this;
 }
 
+
+const ServerSocket& ServerSocket::operator >> ( std::string_view& s ) const
+{
+  SocketResult<size_t> r = try_recv ( s );
+  if ( ! r || *r == 0 )
+    {
+      throw SocketException ( "Could not read from socket.", r.error() );
+    }
+
+  return *this;
+}
+
+
+void ServerSocket::send_message ( const std::string& s ) const
+{
+  SocketResult<void> r = try_send_message ( s );
+  if ( ! r )
+    {
+      throw SocketException ( "Could not write message to socket.", r.error() );
+    }
+}
+
+
+void ServerSocket::recv_message ( std::string& s ) const
+{
+  SocketResult<bool> r = try_recv_message ( s );
+  if ( ! r || ! *r )
+    {
+      throw SocketException ( "Could not read message from socket.", r.error() );
+    }
+}
+
+
+size_t ServerSocket::recv_messages ( std::vector<std::string_view>& v ) const
+{
+  SocketResult<size_t> r = try_recv_messages ( v );
+  if ( ! r || *r == 0 )
+    {
+      throw SocketException ( "Could not read message from socket.", r.error() );
+    }
+
+  return *r;
+}
+
+
+void ServerSocket::send_messages ( std::span<const std::string_view> v ) const
+{
+  SocketResult<void> r = try_send_messages ( v );
+  if ( ! r )
+    {
+      throw SocketException ( "Could not write message to socket.", r.error() );
+    }
+}
+
+
+void ServerSocket::send_fds ( std::string_view s, std::span<const int> fds ) const
+{
+  SocketResult<void> r = try_send_fds ( s, fds );
+  if ( ! r )
+    {
+      throw SocketException ( "Could not pass descriptors on socket.", r.error() );
+    }
+}
+
+
+size_t ServerSocket::recv_fds ( std::span<char> buf, std::vector<int>& fds ) const
+{
+  SocketResult<size_t> r = try_recv_fds ( buf, fds );
+  if ( ! r || *r == 0 )
+    {
+      throw SocketException ( "Could not receive descriptors from socket.", r.error() );
+    }
+
+  return *r;
+}
+
+
+size_t ServerSocket::send_file ( int fd, off_t offset, size_t count ) const
+{
+  SocketResult<size_t> r = try_send_file ( fd, offset, count );
+  if ( ! r )
+    {
+      throw SocketException ( "Could not send file to socket.", r.error() );
+    }
+
+  return *r;
+}
+
+
+uint32_t ServerSocket::send_zerocopy ( std::span<const char> buf ) const
+{
+  SocketResult<uint32_t> r = try_send_zerocopy ( buf );
+  if ( ! r )
+    {
+      throw SocketException ( "Could not write to socket.", r.error() );
+    }
+
+  return *r;
+}
+
+
+void ServerSocket::wait_zerocopy ( uint32_t ticket ) const
+{
+  SocketResult<void> r = try_wait_zerocopy ( ticket );
+  if ( ! r )
+    {
+      throw SocketException ( "Could not wait for zero-copy send.", r.error() );
+    }
+}
+
+
+void ServerSocket::send ( std::initializer_list<std::string_view> pieces ) const
+{
+  SocketResult<void> r = try_send ( pieces );
+  if ( ! r )
+    {
+      throw SocketException ( "Could not write to socket.", r.error() );
+    }
+}
+
+
+SocketResult<void> ServerSocket::try_send ( std::initializer_list<std::string_view> pieces ) const
+{
+  std::vector<iovec> iov ( pieces.size() );
+
+  size_t i = 0;
+  for ( std::string_view piece : pieces )
+    {
+      iov[i].iov_base = const_cast<char*> ( piece.data() );
+      iov[i].iov_len = piece.size();
+      i++;
+    }
+
+  return Socket::send ( std::span<const iovec> ( iov ) );
+}
+
+
+void ServerSocket::cork()
+{
+  Socket::set_corked ( true );
+}
+
+
+void ServerSocket::uncork()
+{
+  SocketResult<void> r = try_uncork();
+  if ( ! r )
+    {
+      throw SocketException ( "Could not write to socket.", r.error() );
+    }
+}
+
+
+void ServerSocket::set_profile ( int profiles )
+{
+  SocketResult<void> r = try_set_profile ( profiles );
+  if ( ! r )
+    {
+      throw SocketException ( "Could not set socket options.", r.error() );
+    }
+}
+
+ServerSocket ServerSocket::accept()
+{
+  ServerSocket sock;
+  accept ( sock );
+  return sock;
+}
+
+
+SocketResult<ServerSocket> ServerSocket::try_accept ( bool non_blocking )
+{
+  ServerSocket sock;
+
+  SocketResult<void> r = try_accept ( sock, non_blocking );
+  if ( ! r )
+    return SocketError ( r.error() );
+
+  return sock;
+}
+
+
 void ServerSocket::accept ( ServerSocket& sock )
 {
-  if ( ! Socket::accept ( sock ) )
+  SocketResult<void> r = try_accept ( sock );
+  if ( ! r )
     {
-      throw SocketException ( "Could not accept socket." );
+      throw SocketException ( "Could not accept socket.", r.error() );
     }
 }
+
+SocketResult<void> ServerSocket::try_accept ( ServerSocket& sock, bool non_blocking )
+{
+  // On a non-blocking listener this fails with EAGAIN once the accept
+  // queue is drained.
+  return Socket::accept ( sock, non_blocking );
+}
@@ -4,21 +4,119 @@
 #define ServerSocket_class
 
 #include "Socket.h"
+#include <errno.h>
+#include <initializer_list>
+#include <string_view>
 
 
+// Accept errors that last until descriptors or memory free up (EMFILE,
+// ENFILE, ENOBUFS, ENOMEM). Retrying them at once only spins, so an
+// acceptor pauses for ACCEPT_BACKOFF_MS instead; EINTR and ECONNABORTED
+// are retried straight away.
+const int ACCEPT_BACKOFF_MS = 100;
+
+inline bool accept_retry_now ( int error )
+{
+  return error == EINTR || error == ECONNABORTED;
+}
+
 class ServerSocket : private Socket
 {
  public:
 
-  ServerSocket ( int port );
+  ServerSocket ( int port, bool reuse_port = false, int backlog = MAXCONNECTIONS );
+
+  // Listens on a local (AF_UNIX) socket instead; see Socket::bind_local.
+  ServerSocket ( const std::string& path, int backlog = MAXCONNECTIONS );
   ServerSocket (){};
   virtual ~ServerSocket();
 
-  const ServerSocket& operator << ( const std::string& ) const;
+  // Move-only, like Socket: connections can live in containers and be
+  // handed to other threads without touching the descriptor.
+  ServerSocket ( ServerSocket&& ) = default;
+  ServerSocket& operator = ( ServerSocket&& ) = default;
+
+  const ServerSocket& operator << ( std::string_view ) const;
   const ServerSocket& operator >> ( std::string& ) const;
+  const ServerSocket& operator >> ( std::string_view& ) const;
+
+  void send_message ( const std::string& ) const;
+  void recv_message ( std::string& ) const;
+
+  // Pipelined messages; see Socket::recv_messages.
+  size_t recv_messages ( std::vector<std::string_view>& ) const;
+  void send_messages ( std::span<const std::string_view> ) const;
+
+  // Descriptor passing over a local socket; see Socket::send_fds.
+  void send_fds ( std::string_view, std::span<const int> ) const;
+  size_t recv_fds ( std::span<char>, std::vector<int>& ) const;
 
+  // Zero-copy bulk sends; see Socket::send_file and send_zerocopy.
+  // enable_zerocopy returns false where MSG_ZEROCOPY is unsupported, and
+  // send_zerocopy then copies as usual.
+  size_t send_file ( int fd, off_t offset, size_t count ) const;
+  bool enable_zerocopy() { return Socket::enable_zerocopy().ok(); }
+  uint32_t send_zerocopy ( std::span<const char> ) const;
+  void wait_zerocopy ( uint32_t ticket ) const;
+  bool zerocopy_done ( uint32_t ticket ) const { return Socket::zerocopy_done ( ticket ); }
+  size_t zerocopy_copied() const { return Socket::zerocopy_copied(); }
+
+  // Gather send, e.g. sock.send ( { header, body } ), in one sendmsg.
+  void send ( std::initializer_list<std::string_view> ) const;
+
+  // Coalesce the << writes between cork() and uncork() into one send.
+  void cork();
+  void uncork();
+
+  // TCP tuning for this connection; see Socket::set_profile.
+  void set_profile ( int profiles );
+
+  // Returns the next connection; the listener keeps listening.
+  ServerSocket accept();
   void accept ( ServerSocket& );
 
+  // The same operations without exceptions: failures carry their errno,
+  // and receives yield 0 (or false for messages) on orderly shutdown.
+  SocketResult<void> try_send ( std::string_view s ) const { return Socket::send ( std::span<const char> ( s ) ); }
+  SocketResult<void> try_send ( std::initializer_list<std::string_view> ) const;
+  SocketResult<size_t> try_recv ( std::string& s ) const { return Socket::recv ( s ); }
+  SocketResult<size_t> try_recv ( std::string_view& s ) const { return Socket::recv ( s ); }
+  SocketResult<void> try_send_message ( const std::string& s ) const { return Socket::send_message ( s ); }
+  SocketResult<bool> try_recv_message ( std::string& s ) const { return Socket::recv_message ( s ); }
+  SocketResult<size_t> try_recv_messages ( std::vector<std::string_view>& v ) const { return Socket::recv_messages ( v ); }
+  SocketResult<void> try_send_messages ( std::span<const std::string_view> v ) const { return Socket::send_messages ( v ); }
+  SocketResult<void> try_uncork() { return Socket::set_corked ( false ); }
+  SocketResult<void> try_set_profile ( int profiles ) { return Socket::set_profile ( profiles ); }
+  SocketResult<void> try_set_no_delay ( bool b ) { return Socket::set_no_delay ( b ); }
+  SocketResult<void> try_set_quick_ack ( bool b ) { return Socket::set_quick_ack ( b ); }
+  SocketResult<void> try_set_tcp_cork ( bool b ) { return Socket::set_tcp_cork ( b ); }
+  SocketResult<void> try_set_busy_poll ( int usec ) { return Socket::set_busy_poll ( usec ); }
+  SocketResult<void> try_set_send_buffer ( int bytes ) { return Socket::set_send_buffer ( bytes ); }
+  SocketResult<void> try_set_recv_buffer ( int bytes ) { return Socket::set_recv_buffer ( bytes ); }
+  SocketResult<void> try_set_keep_alive ( int idle_s, int interval_s = KEEPALIVE_INTERVAL, int count = KEEPALIVE_COUNT ) { return Socket::set_keep_alive ( idle_s, interval_s, count ); }
+  SocketResult<int> send_buffer() const { return Socket::send_buffer(); }
+  SocketResult<int> recv_buffer() const { return Socket::recv_buffer(); }
+  SocketResult<void> try_send_fds ( std::string_view s, std::span<const int> fds ) const { return Socket::send_fds ( s, fds ); }
+  SocketResult<size_t> try_send_file ( int fd, off_t offset, size_t count ) const { return Socket::send_file ( fd, offset, count ); }
+  SocketResult<uint32_t> try_send_zerocopy ( std::span<const char> buf ) const { return Socket::send_zerocopy ( buf ); }
+  SocketResult<void> try_wait_zerocopy ( uint32_t ticket ) const { return Socket::wait_zerocopy ( ticket ); }
+  SocketResult<size_t> try_recv_fds ( std::span<char> buf, std::vector<int>& fds ) const { return Socket::recv_fds ( buf, fds ); }
+  SocketResult<ServerSocket> try_accept ( bool non_blocking = false );
+  SocketResult<void> try_accept ( ServerSocket&, bool non_blocking = false );
+
+  // Non-blocking use with an EventLoop
+  ssize_t read_some ( char* buf, size_t len ) const { return Socket::read_some ( buf, len ); }
+  ssize_t write_some ( const char* buf, size_t len ) const { return Socket::write_some ( buf, len ); }
+  ssize_t write_some ( std::span<const iovec> iov ) const { return Socket::write_some ( iov ); }
+
+  // Writes what earlier sends left kept; EAGAIN while some is still
+  // left, which pending() counts.
+  SocketResult<void> try_flush() const { return Socket::flush(); }
+  size_t pending() const { return Socket::pending(); }
+
+  void set_non_blocking ( const bool b ) { Socket::set_non_blocking ( b ); }
+  int fd() const { return Socket::fd(); }
+
 };
 
 
@@ -0,0 +1,73 @@
+// Implementation of the ShardedServer class
+
+#include "ShardedServer.h"
+#include "SocketException.h"
+#include <pthread.h>
+#include <sched.h>
+#include <iostream>
+
+
+ShardedServer::ShardedServer ( int port,
+			       ReactorServer::DataHandler handler,
+			       size_t shards,
+			       bool pin_cpus ) :
+  m_port ( port ),
+  m_handler ( handler ),
+  m_shards ( shards ),
+  m_pin_cpus ( pin_cpus )
+{
+  if ( m_shards == 0 )
+    m_shards = std::thread::hardware_concurrency();
+
+  if ( m_shards == 0 )
+    m_shards = 1;
+
+  // Bind every listener up front so a port conflict throws here rather
+  // than on a shard thread.
+  for ( size_t i = 0; i < m_shards; i++ )
+    m_listeners.push_back ( std::unique_ptr<ServerSocket> ( new ServerSocket ( m_port, true, SOMAXCONN ) ) );
+}
+
+ShardedServer::~ShardedServer()
+{
+  for ( size_t i = 0; i < m_threads.size(); i++ )
+    m_threads[i].join();
+}
+
+
+void ShardedServer::run()
+{
+  for ( size_t i = 0; i < m_shards; i++ )
+    m_threads.push_back ( std::thread ( &ShardedServer::serve, this, i ) );
+
+  for ( size_t i = 0; i < m_threads.size(); i++ )
+    m_threads[i].join();
+
+  m_threads.clear();
+}
+
+
+void ShardedServer::serve ( size_t shard )
+{
+  if ( m_pin_cpus )
+    {
+      size_t ncpus = std::thread::hardware_concurrency();
+
+      cpu_set_t cpus;
+      CPU_ZERO ( &cpus );
+      CPU_SET ( shard % ( ncpus > 0 ? ncpus : 1 ), &cpus );
+
+      if ( pthread_setaffinity_np ( pthread_self(), sizeof ( cpus ), &cpus ) != 0 )
+	std::cout << "Could not pin shard " << shard << " to a CPU\n";
+    }
+
+  try
+    {
+      ReactorServer server ( *m_listeners[shard], m_handler );
+      server.run();
+    }
+  catch ( SocketException& e )
+    {
+      std::cout << "Shard " << shard << " exception:" << e.description() << "\n";
+    }
+}
@@ -0,0 +1,47 @@
+// Definition of the ShardedServer class
+
+#ifndef ShardedServer_class
+#define ShardedServer_class
+
+#include "ReactorServer.h"
+#include <thread>
+#include <vector>
+
+
+// Runs one ReactorServer per shard, each on its own thread with its own
+// SO_REUSEPORT listening socket, so the kernel load-balances new
+// connections across the accept queues. Shard i can be pinned to CPU i.
+class ShardedServer
+{
+ public:
+
+  ShardedServer ( int port,
+		  ReactorServer::DataHandler handler,
+		  size_t shards = 0,
+		  bool pin_cpus = false );
+  virtual ~ShardedServer();
+
+  // Starts every shard and waits for them to finish.
+  void run();
+
+  size_t shards() const { return m_shards; }
+
+ private:
+
+  ShardedServer ( const ShardedServer& );
+  ShardedServer& operator = ( const ShardedServer& );
+
+  void serve ( size_t shard );
+
+  int m_port;
+  ReactorServer::DataHandler m_handler;
+  size_t m_shards;
+  bool m_pin_cpus;
+
+  std::vector<std::unique_ptr<ServerSocket> > m_listeners;
+  std::vector<std::thread> m_threads;
+
+};
+
+
+#endif
@@ -0,0 +1,98 @@
+// Definition of the SharedBuffer class
+
+#ifndef SharedBuffer_class
+#define SharedBuffer_class
+
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <initializer_list>
+#include <new>
+#include <string_view>
+
+
+// Immutable bytes with a reference count, for a message encoded once and
+// queued on many connections: each WriteQueue holding it takes a
+// reference instead of a copy and drops it once the bytes are written.
+// The count and the bytes share one allocation. The count is atomic, so
+// references may be taken and dropped on different threads.
+//
+//   SharedBuffer* b = SharedBuffer::create ( msg );
+//   for ( ... ) conn.send ( b );
+//   b->unref();
+class SharedBuffer
+{
+ public:
+
+  // Returns a buffer holding a copy of s, with one reference.
+  static SharedBuffer* create ( std::string_view s )
+  {
+    SharedBuffer* b = allocate ( s.size() );
+    memcpy ( reinterpret_cast<char*> ( b + 1 ), s.data(), s.size() );
+
+    return b;
+  }
+
+  // The parts one after another, e.g. { topic, " ", payload, "\n" }.
+  static SharedBuffer* create ( std::initializer_list<std::string_view> parts )
+  {
+    size_t size = 0;
+
+    for ( std::string_view s : parts )
+      size += s.size();
+
+    SharedBuffer* b = allocate ( size );
+    char* p = reinterpret_cast<char*> ( b + 1 );
+
+    for ( std::string_view s : parts )
+      {
+	memcpy ( p, s.data(), s.size() );
+	p += s.size();
+      }
+
+    return b;
+  }
+
+  void ref() { m_refs.fetch_add ( 1, std::memory_order_relaxed ); }
+
+  void unref()
+  {
+    if ( m_refs.fetch_sub ( 1, std::memory_order_acq_rel ) == 1 )
+      {
+	this->~SharedBuffer();
+	free ( this );
+      }
+  }
+
+  const char* data() const { return reinterpret_cast<const char*> ( this + 1 ); }
+  size_t size() const { return m_size; }
+  std::string_view view() const { return std::string_view ( data(), m_size ); }
+
+  size_t refs() const { return m_refs.load ( std::memory_order_relaxed ); }
+
+ private:
+
+  SharedBuffer ( size_t size ) : m_refs ( 1 ), m_size ( size ) {};
+
+  static SharedBuffer* allocate ( size_t size )
+  {
+    void* p = malloc ( sizeof ( SharedBuffer ) + size );
+
+    if ( ! p )
+      throw std::bad_alloc();
+
+    return new ( p ) SharedBuffer ( size );
+  }
+
+  ~SharedBuffer() {};
+
+  SharedBuffer ( const SharedBuffer& );
+  SharedBuffer& operator = ( const SharedBuffer& );
+
+  std::atomic<size_t> m_refs;
+  size_t m_size;
+
+};
+
+
+#endif
@@ -0,0 +1,126 @@
+// Definition of the Slab class
+
+#ifndef Slab_class
+#define Slab_class
+
+#include <stddef.h>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+
+const size_t CACHE_LINE = 64;
+const size_t SLAB_CHUNK = 256;
+
+// Per-connection objects stored by descriptor. The kernel hands out the
+// lowest free fd, so under churn a new connection lands in the slot the
+// last one left: create, get and destroy are an index and a placement
+// new, with no malloc and no hashing. Each slot starts on its own cache
+// line, so neighbouring connections never share one. Slots come in
+// chunks of SLAB_CHUNK that never move, so pointers stay valid until
+// the object is destroyed; chunks are kept for reuse, not freed.
+template <class T>
+class Slab
+{
+ public:
+
+  Slab() : m_size ( 0 ) {};
+  virtual ~Slab() { clear(); }
+
+  // Constructs the object for fd, replacing any already there.
+  template <class... Args>
+  T* create ( int fd, Args&&... args )
+  {
+    Slot& s = slot ( fd );
+
+    if ( s.used )
+      destroy ( fd );
+
+    T* t = new ( s.storage ) T ( std::forward<Args> ( args )... );
+    s.used = true;
+    m_size++;
+
+    return t;
+  }
+
+  // The object for fd, or 0.
+  T* get ( int fd ) const
+  {
+    size_t c = fd / SLAB_CHUNK;
+
+    if ( fd < 0 || c >= m_chunks.size() || ! m_chunks[c] )
+      return 0;
+
+    Slot& s = m_chunks[c][fd % SLAB_CHUNK];
+
+    return s.used ? object ( s ) : 0;
+  }
+
+  bool destroy ( int fd )
+  {
+    T* t = get ( fd );
+
+    if ( ! t )
+      return false;
+
+    // Marked free first, so a destructor that looks fd up again finds
+    // nothing.
+    m_chunks[fd / SLAB_CHUNK][fd % SLAB_CHUNK].used = false;
+    m_size--;
+    t->~T();
+
+    return true;
+  }
+
+  // Calls f ( fd, object ) for every live object.
+  template <class F>
+  void for_each ( F f ) const
+  {
+    for ( size_t c = 0; c < m_chunks.size(); c++ )
+      for ( size_t i = 0; m_chunks[c] && i < SLAB_CHUNK; i++ )
+	if ( m_chunks[c][i].used )
+	  f ( ( int ) ( c * SLAB_CHUNK + i ), *object ( m_chunks[c][i] ) );
+  }
+
+  void clear()
+  {
+    for ( size_t fd = 0; fd < m_chunks.size() * SLAB_CHUNK; fd++ )
+      destroy ( fd );
+  }
+
+  size_t size() const { return m_size; }
+
+ private:
+
+  Slab ( const Slab& );
+  Slab& operator = ( const Slab& );
+
+  struct alignas ( CACHE_LINE ) Slot
+  {
+    alignas ( T ) unsigned char storage [ sizeof ( T ) ];
+    bool used;
+  };
+
+  static T* object ( Slot& s ) { return std::launder ( reinterpret_cast<T*> ( s.storage ) ); }
+
+  Slot& slot ( int fd )
+  {
+    size_t c = fd / SLAB_CHUNK;
+
+    if ( c >= m_chunks.size() )
+      m_chunks.resize ( c + 1 );
+
+    if ( ! m_chunks[c] )
+      m_chunks[c].reset ( new Slot [ SLAB_CHUNK ]() );
+
+    return m_chunks[c][fd % SLAB_CHUNK];
+  }
+
+  std::vector<std::unique_ptr<Slot[]> > m_chunks;
+  size_t m_size;
+
+};
+
+
+#endif
@@ -2,15 +2,32 @@
 
 
 #include "Socket.h"
+#include "SocketMetrics.h"
 #include "string.h"
 #include <string.h>
 #include <errno.h>
 #include <fcntl.h>
-#include <iostream>
+#include <limits.h>
+#include <poll.h>
+#include <stddef.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/tcp.h>
+#include <linux/errqueue.h>
+#include <algorithm>
 
 
 Socket::Socket() :
-  m_sock ( -1 )
+  m_sock ( -1 ),
+  m_connected ( false ),
+  m_rbegin ( 0 ),
+  m_rend ( 0 ),
+  m_corked ( false ),
+  m_zerocopy ( false ),
+  m_zc_next ( 0 ),
+  m_zc_done ( 0 ),
+  m_zc_copied ( 0 )
 {
 
   memset ( &m_addr,
@@ -22,37 +39,186 @@ Socket::Socket() :
 Socket::~Socket()
 {
   if ( is_valid() )
-    ::close ( m_sock );
+    {
+      // One try for anything still buffered: closing must not wait on a
+      // peer that has stopped reading, so what the kernel will not take
+      // at once is dropped.
+      if ( ! m_wbuf.empty() )
+	{
+	  iovec iov = { &m_wbuf[0], m_wbuf.size() };
+	  send_some ( &iov, 1, MSG_DONTWAIT );
+	}
+
+      ::close ( m_sock );
+
+      if ( m_connected )
+	SocketMetrics::count ( SocketMetrics::CLOSES );
+    }
+
+  if ( ! m_path.empty() )
+    ::unlink ( m_path.c_str() );
+}
+
+Socket::Socket ( Socket&& s ) :
+  Socket()
+{
+  swap ( s );
 }
 
-bool Socket::create()
+Socket& Socket::operator = ( Socket&& s )
+{
+  if ( this != &s )
+    {
+      // What this held ends up in old, which closes it.
+      Socket old ( std::move ( s ) );
+      swap ( old );
+    }
+
+  return *this;
+}
+
+void Socket::swap ( Socket& s )
+{
+  std::swap ( m_sock, s.m_sock );
+  std::swap ( m_addr, s.m_addr );
+  m_path.swap ( s.m_path );
+  std::swap ( m_connected, s.m_connected );
+  m_rbuf.swap ( s.m_rbuf );
+  std::swap ( m_rbegin, s.m_rbegin );
+  std::swap ( m_rend, s.m_rend );
+  std::swap ( m_corked, s.m_corked );
+  m_wbuf.swap ( s.m_wbuf );
+  m_lens.swap ( s.m_lens );
+  m_iov.swap ( s.m_iov );
+  std::swap ( m_zerocopy, s.m_zerocopy );
+  std::swap ( m_zc_next, s.m_zc_next );
+  std::swap ( m_zc_done, s.m_zc_done );
+  m_zc_ranges.swap ( s.m_zc_ranges );
+  std::swap ( m_zc_copied, s.m_zc_copied );
+}
+
+SocketResult<void> Socket::create()
 {
   m_sock = socket ( AF_INET,
 		    SOCK_STREAM,
 		    0 );
 
   if ( ! is_valid() )
-    return false;
+    return SocketError ( errno );
 
 
   // TIME_WAIT - argh
   int on = 1;
   if ( setsockopt ( m_sock, SOL_SOCKET, SO_REUSEADDR, ( const char* ) &on, sizeof ( on ) ) == -1 )
+    return SocketError ( errno );
+
+
+  return {};
+
+}
+
+
+// Lets several sockets bind the same port; the kernel then spreads new
+// connections across their accept queues. Must be set before bind().
+SocketResult<void> Socket::set_reuse_port()
+{
+  int on = 1;
+  if ( setsockopt ( m_sock, SOL_SOCKET, SO_REUSEPORT, &on, sizeof ( on ) ) == -1 )
+    return SocketError ( errno );
+
+  return {};
+}
+
+
+SocketResult<void> Socket::create_local()
+{
+  m_sock = socket ( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+
+  if ( ! is_valid() )
+    return SocketError ( errno );
+
+  return {};
+}
+
+
+// Fills in an AF_UNIX address; '@' at the start selects the abstract
+// namespace, whose names begin with a NUL byte instead.
+static bool local_address ( const std::string& path, sockaddr_un& addr, socklen_t& len )
+{
+  memset ( &addr, 0, sizeof ( addr ) );
+  addr.sun_family = AF_UNIX;
+
+  if ( path.empty() || path.size() >= sizeof ( addr.sun_path ) )
     return false;
 
+  memcpy ( addr.sun_path, path.data(), path.size() );
+
+  if ( path[0] == '@' )
+    {
+      addr.sun_path[0] = '\0';
+      len = offsetof ( sockaddr_un, sun_path ) + path.size();
+    }
+  else
+    len = sizeof ( addr );
 
   return true;
+}
+
+
+SocketResult<void> Socket::bind_local ( const std::string& path )
+{
+  if ( ! is_valid() )
+    return SocketError ( EBADF );
+
+  sockaddr_un addr;
+  socklen_t len;
+
+  if ( ! local_address ( path, addr, len ) )
+    return SocketError ( ENAMETOOLONG );
 
+  // A socket file left by a previous run would make bind fail; anything
+  // other than a socket is left alone.
+  struct stat st;
+  if ( path[0] != '@' && ::stat ( path.c_str(), &st ) == 0 && S_ISSOCK ( st.st_mode ) )
+    ::unlink ( path.c_str() );
+
+  if ( ::bind ( m_sock, ( sockaddr * ) &addr, len ) == -1 )
+    return SocketError ( errno );
+
+  if ( path[0] != '@' )
+    m_path = path;
+
+  return {};
 }
 
 
+SocketResult<void> Socket::connect_local ( const std::string& path )
+{
+  if ( ! is_valid() )
+    return SocketError ( EBADF );
+
+  sockaddr_un addr;
+  socklen_t len;
+
+  if ( ! local_address ( path, addr, len ) )
+    return SocketError ( ENAMETOOLONG );
+
+  if ( ::connect ( m_sock, ( sockaddr * ) &addr, len ) == -1 )
+    return SocketError ( errno );
+
+  m_connected = true;
+  SocketMetrics::count ( SocketMetrics::CONNECTS );
+
+  return {};
+}
 
-bool Socket::bind ( const int port )
+
+SocketResult<void> Socket::bind ( const int port )
 {
 
   if ( ! is_valid() )
     {
-      return false;
+      return SocketError ( EBADF );
     }
 
 
@@ -68,105 +234,945 @@ bool Socket::bind ( const int port )
 
   if ( bind_return == -1 )
     {
-      return false;
+      return SocketError ( errno );
     }
 
-  return true;
+  return {};
 }
 
 
-bool Socket::listen() const
+SocketResult<void> Socket::listen ( const int backlog ) const
 {
   if ( ! is_valid() )
     {
-      return false;
+      return SocketError ( EBADF );
     }
 
-  int listen_return = ::listen ( m_sock, MAXCONNECTIONS );
+  int listen_return = ::listen ( m_sock, backlog );
 
 
   if ( listen_return == -1 )
     {
-      return false;
+      return SocketError ( errno );
     }
 
-  return true;
+  return {};
 }
 
 
-bool Socket::accept ( Socket& new_socket ) const
+SocketResult<void> Socket::accept ( Socket& new_socket, const bool non_blocking ) const
 {
-  int addr_length = sizeof ( m_addr );
-  new_socket.m_sock = ::accept ( m_sock, ( sockaddr * ) &m_addr, ( socklen_t * ) &addr_length );
+  // accept4 sets the flags atomically, saving the fcntl round trips of
+  // set_non_blocking and keeping the descriptor out of exec'd children.
+  int flags = SOCK_CLOEXEC | ( non_blocking ? SOCK_NONBLOCK : 0 );
+  socklen_t addr_length = sizeof ( new_socket.m_addr );
 
-  if ( new_socket.m_sock <= 0 )
-    return false;
+  // A socket being reused gives up what it held, rather than leaking it.
+  if ( new_socket.is_valid() )
+    new_socket = Socket();
+
+  do
+    {
+      new_socket.m_sock = ::accept4 ( m_sock, ( sockaddr * ) &new_socket.m_addr, &addr_length, flags );
+      SocketMetrics::count ( SocketMetrics::ACCEPT_CALLS );
+    }
+  while ( new_socket.m_sock == -1 && errno == EINTR );
+
+  if ( new_socket.m_sock == -1 )
+    {
+      if ( errno == EAGAIN || errno == EWOULDBLOCK )
+	SocketMetrics::count ( SocketMetrics::EAGAINS );
+      return SocketError ( errno );
+    }
+
+  new_socket.m_connected = true;
+  SocketMetrics::count ( SocketMetrics::ACCEPTS );
+
+  return {};
+}
+
+
+SocketResult<void> Socket::send ( const std::string& s ) const
+{
+  return send ( std::span<const char> ( s.data(), s.size() ) );
+}
+
+
+SocketResult<void> Socket::send ( std::span<const iovec> iov ) const
+{
+  if ( m_corked )
+    {
+      SocketResult<void> r = make_room();
+      if ( ! r )
+	return r;
+
+      for ( size_t i = 0; i < iov.size(); i++ )
+	m_wbuf.append ( ( const char* ) iov[i].iov_base, iov[i].iov_len );
+
+      if ( m_wbuf.size() < MAXCORK )
+	return {};
+
+      // Taken: whatever the kernel has no room for stays kept.
+      r = flush();
+      if ( ! r && r.error() != EAGAIN )
+	return r;
+
+      return {};
+    }
+
+  return send_all ( iov.data(), iov.size() );
+}
+
+
+SocketResult<void> Socket::set_corked ( const bool b )
+{
+  m_corked = b;
+
+  if ( b )
+    return {};
+
+  return flush();
+}
+
+
+SocketResult<void> Socket::flush() const
+{
+  if ( m_wbuf.empty() )
+    return {};
+
+  iovec iov;
+  iov.iov_base = &m_wbuf[0];
+  iov.iov_len = m_wbuf.size();
+
+  SocketResult<size_t> n = send_some ( &iov, 1 );
+
+  if ( ! n )
+    {
+      m_wbuf.clear();
+      return SocketError ( n.error() );
+    }
+
+  m_wbuf.erase ( 0, *n );
+
+  if ( ! m_wbuf.empty() )
+    return SocketError ( EAGAIN );
+
+  return {};
+}
+
+
+static size_t iov_bytes ( const iovec* iov, size_t count )
+{
+  size_t n = 0;
+
+  for ( size_t i = 0; i < count; i++ )
+    n += iov[i].iov_len;
+
+  return n;
+}
+
+
+// EAGAIN, with nothing written, while MAXPENDING or more bytes are kept
+// and the kernel will not take enough of them.
+SocketResult<void> Socket::make_room() const
+{
+  if ( m_wbuf.size() < MAXPENDING )
+    return {};
+
+  return flush();
+}
+
+
+SocketResult<void> Socket::send_all ( const iovec* iov, size_t count ) const
+{
+  SocketResult<void> r = make_room();
+  if ( ! r )
+    return r;
+
+  // Behind bytes kept from earlier sends, to stay in order.
+  if ( ! m_wbuf.empty() )
+    {
+      for ( size_t i = 0; i < count; i++ )
+	m_wbuf.append ( ( const char* ) iov[i].iov_base, iov[i].iov_len );
+
+      r = flush();
+      if ( ! r && r.error() != EAGAIN )
+	return r;
+
+      return {};
+    }
+
+  SocketResult<size_t> n = send_some ( iov, count );
+
+  if ( ! n )
+    return SocketError ( n.error() );
+
+  if ( *n == 0 && iov_bytes ( iov, count ) > 0 )
+    return SocketError ( EAGAIN );
+
+  // A non-blocking socket that filled up part way keeps the rest.
+  size_t skip = *n;
+
+  for ( size_t i = 0; i < count; i++ )
+    {
+      if ( skip >= iov[i].iov_len )
+	{
+	  skip -= iov[i].iov_len;
+	  continue;
+	}
+
+      m_wbuf.append ( ( const char* ) iov[i].iov_base + skip, iov[i].iov_len - skip );
+      skip = 0;
+    }
+
+  return {};
+}
+
+
+SocketResult<size_t> Socket::send_some ( const iovec* iov, size_t count, int flags ) const
+{
+  // The caller's array is only copied if a partial write forces us to
+  // adjust it.
+  std::vector<iovec> rest;
+  size_t sent = 0;
+
+  msghdr msg = msghdr();
+  msg.msg_iov = const_cast<iovec*> ( iov );
+
+  while ( count > 0 )
+    {
+      msg.msg_iovlen = std::min ( count, ( size_t ) IOV_MAX );
+
+      uint64_t start = SocketMetrics::now();
+      ssize_t status = ::sendmsg ( m_sock, &msg, MSG_NOSIGNAL | flags );
+      SocketMetrics::io ( SocketMetrics::SEND, start, status, iov_bytes ( msg.msg_iov, msg.msg_iovlen ) );
+
+      if ( status == -1 )
+	{
+	  if ( errno == EINTR )
+	    continue;
+
+	  if ( errno == EAGAIN || errno == EWOULDBLOCK )
+	    break;
+
+	  return SocketError ( errno );
+	}
+
+      sent += status;
+
+      while ( count > 0 && ( size_t ) status >= msg.msg_iov->iov_len )
+	{
+	  status -= msg.msg_iov->iov_len;
+	  msg.msg_iov++;
+	  count--;
+	}
+
+      if ( count > 0 && status > 0 )
+	{
+	  if ( rest.empty() )
+	    {
+	      rest.assign ( msg.msg_iov, msg.msg_iov + count );
+	      msg.msg_iov = &rest[0];
+	    }
+
+	  msg.msg_iov->iov_base = ( char* ) msg.msg_iov->iov_base + status;
+	  msg.msg_iov->iov_len -= status;
+	}
+    }
+
+  return sent;
+}
+
+
+SocketResult<size_t> Socket::recv ( std::string& s ) const
+{
+  // Hand out anything recv_message read ahead before touching the socket.
+  if ( m_rend > m_rbegin )
+    {
+      size_t n = std::min ( m_rend - m_rbegin, ( size_t ) MAXRECV );
+      s.assign ( &m_rbuf[m_rbegin], n );
+      m_rbegin += n;
+      return n;
+    }
+
+  // Receive straight into the string; a string reused across calls keeps
+  // its capacity, so steady-state reads neither allocate nor copy.
+  s.resize ( MAXRECV );
+
+  ssize_t status = read_some ( &s[0], MAXRECV );
+
+  if ( status == -1 )
+    {
+      int e = errno;
+      s.clear();
+      return SocketError ( e );
+    }
   else
-    return true;
+    {
+      s.resize ( status );
+      return status;
+    }
 }
 
 
-bool Socket::send ( const std::string s ) const
+SocketResult<size_t> Socket::recv ( std::span<char> buf ) const
 {
-  int status = ::send ( m_sock, s.c_str(), s.size(), MSG_NOSIGNAL );
+  if ( m_rend > m_rbegin )
+    {
+      size_t n = std::min ( m_rend - m_rbegin, buf.size() );
+      memcpy ( buf.data(), &m_rbuf[m_rbegin], n );
+      m_rbegin += n;
+      return n;
+    }
+
+  ssize_t status = read_some ( buf.data(), buf.size() );
+
   if ( status == -1 )
+    return SocketError ( errno );
+
+  return status;
+}
+
+
+SocketResult<size_t> Socket::recv ( std::string_view& s ) const
+{
+  if ( m_rend > m_rbegin )
     {
+      s = std::string_view ( &m_rbuf[m_rbegin], m_rend - m_rbegin );
+      m_rbegin = m_rend = 0;
+      return s.size();
+    }
+
+  m_rbegin = m_rend = 0;
+
+  // Read as much as a pipelining peer may have sent, not one small
+  // message's worth.
+  if ( m_rbuf.size() < READ_AHEAD )
+    m_rbuf.resize ( READ_AHEAD );
+
+  ssize_t status = read_some ( &m_rbuf[0], m_rbuf.size() );
+
+  if ( status <= 0 )
+    {
+      s = std::string_view();
+
+      if ( status == -1 )
+	return SocketError ( errno );
+
+      return 0;
+    }
+
+  s = std::string_view ( &m_rbuf[0], status );
+  return status;
+}
+
+
+SocketResult<void> Socket::send ( std::span<const char> buf ) const
+{
+  iovec iov;
+  iov.iov_base = const_cast<char*> ( buf.data() );
+  iov.iov_len = buf.size();
+
+  return send ( std::span<const iovec> ( &iov, 1 ) );
+}
+
+
+SocketResult<void> Socket::send_message ( const std::string& s ) const
+{
+  if ( s.size() > MAXMESSAGE )
+    return SocketError ( EMSGSIZE );
+
+  uint32_t len = htonl ( s.size() );
+
+  iovec iov[2];
+  iov[0].iov_base = &len;
+  iov[0].iov_len = sizeof ( len );
+  iov[1].iov_base = const_cast<char*> ( s.data() );
+  iov[1].iov_len = s.size();
+
+  return send ( std::span<const iovec> ( iov, 2 ) );
+}
+
+
+// Waits until a whole message is buffered at m_rbegin and yields its
+// payload length; false if the peer closed between messages.
+SocketResult<bool> Socket::next_message ( uint32_t& len ) const
+{
+  SocketResult<bool> r = fill_buffer ( sizeof ( len ) );
+  if ( ! r )
+    return r;
+
+  if ( ! *r )
+    {
+      if ( m_rend > m_rbegin )
+	return SocketError ( ECONNRESET );
       return false;
     }
-  else
+
+  memcpy ( &len, &m_rbuf[m_rbegin], sizeof ( len ) );
+  len = ntohl ( len );
+
+  if ( len > MAXMESSAGE )
+    return SocketError ( EMSGSIZE );
+
+  r = fill_buffer ( sizeof ( len ) + len );
+  if ( ! r )
+    return r;
+
+  if ( ! *r )
+    return SocketError ( ECONNRESET );
+
+  return true;
+}
+
+
+SocketResult<bool> Socket::recv_message ( std::string& s ) const
+{
+  uint32_t len;
+
+  SocketResult<bool> r = next_message ( len );
+  if ( ! r || ! *r )
+    return r;
+
+  s.assign ( &m_rbuf[m_rbegin] + sizeof ( len ), len );
+  m_rbegin += sizeof ( len ) + len;
+
+  return true;
+}
+
+
+SocketResult<size_t> Socket::recv_messages ( std::vector<std::string_view>& out ) const
+{
+  out.clear();
+
+  uint32_t len;
+
+  SocketResult<bool> r = next_message ( len );
+  if ( ! r )
+    return SocketError ( r.error() );
+
+  if ( ! *r )
+    return 0;
+
+  // Everything complete that the same reads brought in goes out in this
+  // batch; a partial or oversized message waits for the next call.
+  size_t pos = m_rbegin;
+
+  while ( m_rend - pos >= sizeof ( len ) )
     {
-      return true;
+      memcpy ( &len, &m_rbuf[pos], sizeof ( len ) );
+      len = ntohl ( len );
+
+      if ( len > MAXMESSAGE || m_rend - pos - sizeof ( len ) < len )
+	break;
+
+      out.push_back ( std::string_view ( &m_rbuf[pos] + sizeof ( len ), len ) );
+      pos += sizeof ( len ) + len;
     }
+
+  m_rbegin = pos;
+
+  return out.size();
 }
 
 
-int Socket::recv ( std::string& s ) const
+SocketResult<void> Socket::send_messages ( std::span<const std::string_view> messages ) const
 {
-  char buf [ MAXRECV + 1 ];
+  m_lens.resize ( messages.size() );
+  m_iov.resize ( 2 * messages.size() );
 
-  s = "";
+  for ( size_t i = 0; i < messages.size(); i++ )
+    {
+      if ( messages[i].size() > MAXMESSAGE )
+	return SocketError ( EMSGSIZE );
 
-  memset ( buf, 0, MAXRECV + 1 );
+      m_lens[i] = htonl ( messages[i].size() );
+      m_iov[2 * i].iov_base = &m_lens[i];
+      m_iov[2 * i].iov_len = sizeof ( uint32_t );
+      m_iov[2 * i + 1].iov_base = const_cast<char*> ( messages[i].data() );
+      m_iov[2 * i + 1].iov_len = messages[i].size();
+    }
 
-  int status = ::recv ( m_sock, buf, MAXRECV, 0 );
+  return send ( std::span<const iovec> ( m_iov ) );
+}
+
+
+SocketResult<void> Socket::send_fds ( std::string_view data, std::span<const int> fds ) const
+{
+  if ( data.empty() || fds.size() > MAXFDS )
+    return SocketError ( EINVAL );
+
+  // Anything corked goes first, so the stream stays in order.
+  SocketResult<void> r = flush();
+  if ( ! r )
+    return r;
+
+  char control [ CMSG_SPACE ( MAXFDS * sizeof ( int ) ) ];
+  memset ( control, 0, sizeof ( control ) );
+
+  iovec iov;
+  iov.iov_base = const_cast<char*> ( data.data() );
+  iov.iov_len = data.size();
+
+  msghdr msg = msghdr();
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+
+  if ( ! fds.empty() )
+    {
+      msg.msg_control = control;
+      msg.msg_controllen = CMSG_SPACE ( fds.size() * sizeof ( int ) );
+
+      cmsghdr* cmsg = CMSG_FIRSTHDR ( &msg );
+      cmsg->cmsg_level = SOL_SOCKET;
+      cmsg->cmsg_type = SCM_RIGHTS;
+      cmsg->cmsg_len = CMSG_LEN ( fds.size() * sizeof ( int ) );
+      memcpy ( CMSG_DATA ( cmsg ), fds.data(), fds.size() * sizeof ( int ) );
+    }
+
+  // The descriptors ride on the first write; whatever is left is plain
+  // data.
+  ssize_t status;
+
+  do
+    {
+      uint64_t start = SocketMetrics::now();
+      status = ::sendmsg ( m_sock, &msg, MSG_NOSIGNAL );
+      SocketMetrics::io ( SocketMetrics::SEND, start, status, data.size() );
+    }
+  while ( status == -1 && errno == EINTR );
 
   if ( status == -1 )
+    return SocketError ( errno );
+
+  // The descriptors are gone, so the rest is kept rather than refused.
+  if ( ( size_t ) status < data.size() )
     {
-      std::cout << "status == -1   errno == " << errno << "  in Socket::recv\n";
-      return 0;
+      m_wbuf.append ( data.data() + status, data.size() - status );
+
+      r = flush();
+      if ( ! r && r.error() != EAGAIN )
+	return r;
     }
-  else if ( status == 0 )
+
+  return {};
+}
+
+
+SocketResult<size_t> Socket::recv_fds ( std::span<char> buf, std::vector<int>& fds ) const
+{
+  char control [ CMSG_SPACE ( MAXFDS * sizeof ( int ) ) ];
+
+  iovec iov;
+  iov.iov_base = buf.data();
+  iov.iov_len = buf.size();
+
+  msghdr msg = msghdr();
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof ( control );
+
+  ssize_t status;
+
+  do
     {
-      return 0;
+      uint64_t start = SocketMetrics::now();
+      status = ::recvmsg ( m_sock, &msg, MSG_CMSG_CLOEXEC );
+      SocketMetrics::io ( SocketMetrics::RECV, start, status, buf.size() );
     }
-  else
+  while ( status == -1 && errno == EINTR );
+
+  if ( status == -1 )
+    return SocketError ( errno );
+
+  for ( cmsghdr* cmsg = CMSG_FIRSTHDR ( &msg ); cmsg; cmsg = CMSG_NXTHDR ( &msg, cmsg ) )
     {
-      s = buf;
-      return status;
+      if ( cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS )
+	continue;
+
+      size_t n = ( cmsg->cmsg_len - CMSG_LEN ( 0 ) ) / sizeof ( int );
+      size_t first = fds.size();
+
+      fds.resize ( first + n );
+      memcpy ( &fds[first], CMSG_DATA ( cmsg ), n * sizeof ( int ) );
+    }
+
+  return status;
+}
+
+
+// Blocks until a non-blocking socket can make progress again.
+static bool wait_for ( int fd, short events )
+{
+  pollfd pfd = { fd, events, 0 };
+  return ::poll ( &pfd, 1, -1 ) != -1 || errno == EINTR;
+}
+
+
+SocketResult<size_t> Socket::send_file ( int fd, off_t offset, size_t count ) const
+{
+  SocketResult<void> r = flush();
+  if ( ! r )
+    return SocketError ( r.error() );
+
+  size_t sent = 0;
+
+  while ( sent < count )
+    {
+      uint64_t start = SocketMetrics::now();
+      ssize_t n = ::sendfile ( m_sock, fd, &offset, count - sent );
+      SocketMetrics::io ( SocketMetrics::SEND, start, n, count - sent );
+
+      if ( n == -1 )
+	{
+	  if ( errno == EINTR )
+	    continue;
+
+	  if ( ( errno == EAGAIN || errno == EWOULDBLOCK ) && wait_for ( m_sock, POLLOUT ) )
+	    continue;
+
+	  // sendfile wants a source it can map; pipes and sockets go
+	  // through splice instead, from wherever they are.
+	  if ( ( errno == EINVAL || errno == ESPIPE ) && sent == 0 )
+	    return splice_file ( fd, count );
+
+	  return SocketError ( errno );
+	}
+
+      if ( n == 0 )
+	break;
+
+      sent += n;
+    }
+
+  return sent;
+}
+
+
+SocketResult<size_t> Socket::splice_file ( int fd, size_t count ) const
+{
+  int pipefd[2];
+
+  if ( ::pipe2 ( pipefd, O_CLOEXEC ) == -1 )
+    return SocketError ( errno );
+
+  size_t sent = 0;
+  int error = 0;
+
+  while ( sent < count && ! error )
+    {
+      ssize_t in = ::splice ( fd, 0, pipefd[1], 0, count - sent, SPLICE_F_MOVE | SPLICE_F_MORE );
+
+      if ( in == -1 )
+	{
+	  if ( errno == EINTR || ( ( errno == EAGAIN || errno == EWOULDBLOCK ) && wait_for ( fd, POLLIN ) ) )
+	    continue;
+	  error = errno;
+	  break;
+	}
+
+      if ( in == 0 )
+	break;
+
+      // Drain the pipe completely before filling it again.
+      while ( in > 0 )
+	{
+	  uint64_t start = SocketMetrics::now();
+	  ssize_t out = ::splice ( pipefd[0], 0, m_sock, 0, in, SPLICE_F_MOVE | SPLICE_F_MORE );
+	  SocketMetrics::io ( SocketMetrics::SEND, start, out, in );
+
+	  if ( out == -1 )
+	    {
+	      if ( errno == EINTR || ( ( errno == EAGAIN || errno == EWOULDBLOCK ) && wait_for ( m_sock, POLLOUT ) ) )
+		continue;
+	      error = errno;
+	      break;
+	    }
+
+	  in -= out;
+	  sent += out;
+	}
+    }
+
+  ::close ( pipefd[0] );
+  ::close ( pipefd[1] );
+
+  if ( error )
+    return SocketError ( error );
+
+  return sent;
+}
+
+
+SocketResult<void> Socket::enable_zerocopy()
+{
+  int on = 1;
+  if ( setsockopt ( m_sock, SOL_SOCKET, SO_ZEROCOPY, &on, sizeof ( on ) ) == -1 )
+    return SocketError ( errno );
+
+  m_zerocopy = true;
+
+  return {};
+}
+
+
+SocketResult<uint32_t> Socket::send_zerocopy ( std::span<const char> buf ) const
+{
+  SocketResult<void> r = flush();
+  if ( ! r )
+    return SocketError ( r.error() );
+
+  if ( ! m_zerocopy || buf.size() < ZEROCOPY_MIN )
+    {
+      iovec iov = { const_cast<char*> ( buf.data() ), buf.size() };
+      r = send_all ( &iov, 1 );
+      if ( ! r )
+	return SocketError ( r.error() );
+      return m_zc_next;
+    }
+
+  size_t sent = 0;
+
+  while ( sent < buf.size() )
+    {
+      uint64_t start = SocketMetrics::now();
+      ssize_t n = ::send ( m_sock, buf.data() + sent, buf.size() - sent, MSG_ZEROCOPY | MSG_NOSIGNAL );
+      SocketMetrics::io ( SocketMetrics::SEND, start, n, buf.size() - sent );
+
+      if ( n == -1 )
+	{
+	  if ( errno == EINTR )
+	    continue;
+
+	  // A full socket, or too many notifications outstanding (ENOBUFS):
+	  // collect completions and wait for room.
+	  if ( errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS )
+	    {
+	      reap_zerocopy();
+	      if ( wait_for ( m_sock, POLLOUT ) )
+		continue;
+	    }
+
+	  return SocketError ( errno );
+	}
+
+      // Every successful call takes the next id, even a partial one.
+      m_zc_next++;
+      sent += n;
+    }
+
+  return m_zc_next;
+}
+
+
+// Reads completion notifications off the error queue. Each names a range
+// of send ids; ranges normally arrive in order and just advance
+// m_zc_done.
+void Socket::reap_zerocopy() const
+{
+  char control [ 128 ];
+
+  while ( true )
+    {
+      msghdr msg = msghdr();
+      msg.msg_control = control;
+      msg.msg_controllen = sizeof ( control );
+
+      if ( ::recvmsg ( m_sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT ) == -1 )
+	break;
+
+      for ( cmsghdr* c = CMSG_FIRSTHDR ( &msg ); c; c = CMSG_NXTHDR ( &msg, c ) )
+	{
+	  sock_extended_err err;
+	  memcpy ( &err, CMSG_DATA ( c ), sizeof ( err ) );
+
+	  if ( err.ee_errno != 0 || err.ee_origin != SO_EE_ORIGIN_ZEROCOPY )
+	    continue;
+
+	  if ( err.ee_code & SO_EE_CODE_ZEROCOPY_COPIED )
+	    m_zc_copied += err.ee_data - err.ee_info + 1;
+
+	  m_zc_ranges.push_back ( std::make_pair ( err.ee_info, err.ee_data ) );
+	}
+    }
+
+  // Fold every range that now touches the done mark.
+  bool progress = true;
+  while ( progress )
+    {
+      progress = false;
+      for ( size_t i = 0; i < m_zc_ranges.size(); i++ )
+	{
+	  if ( ( int32_t ) ( m_zc_ranges[i].first - m_zc_done ) > 0 )
+	    continue;
+
+	  if ( ( int32_t ) ( m_zc_ranges[i].second + 1 - m_zc_done ) > 0 )
+	    m_zc_done = m_zc_ranges[i].second + 1;
+
+	  m_zc_ranges[i] = m_zc_ranges.back();
+	  m_zc_ranges.pop_back();
+	  progress = true;
+	  break;
+	}
+    }
+}
+
+
+bool Socket::zerocopy_done ( uint32_t ticket ) const
+{
+  if ( ( int32_t ) ( ticket - m_zc_done ) > 0 )
+    reap_zerocopy();
+
+  return ( int32_t ) ( ticket - m_zc_done ) <= 0;
+}
+
+
+SocketResult<void> Socket::wait_zerocopy ( uint32_t ticket ) const
+{
+  // Completions raise POLLERR, which poll reports whatever is asked for.
+  while ( ! zerocopy_done ( ticket ) )
+    {
+      pollfd pfd = { m_sock, 0, 0 };
+      if ( ::poll ( &pfd, 1, -1 ) == -1 && errno != EINTR )
+	return SocketError ( errno );
+
+      if ( pfd.revents & ( POLLHUP | POLLNVAL ) && ! zerocopy_done ( ticket ) )
+	return SocketError ( ECONNRESET );
+    }
+
+  return {};
+}
+
+
+// Reads until need bytes are buffered; false if the peer closes first.
+SocketResult<bool> Socket::fill_buffer ( size_t need ) const
+{
+  while ( m_rend - m_rbegin < need )
+    {
+      if ( m_rbegin == m_rend )
+	m_rbegin = m_rend = 0;
+
+      // Make room at the tail: slide unread bytes to the front first, and
+      // only grow once the buffer itself is too small.
+      if ( m_rbuf.size() - m_rend < std::max ( need - ( m_rend - m_rbegin ), READ_AHEAD ) )
+	{
+	  if ( m_rbegin > 0 )
+	    {
+	      memmove ( &m_rbuf[0], &m_rbuf[m_rbegin], m_rend - m_rbegin );
+	      m_rend -= m_rbegin;
+	      m_rbegin = 0;
+	    }
+
+	  size_t want = std::max ( need, m_rend + READ_AHEAD );
+	  if ( m_rbuf.size() < want )
+	    m_rbuf.resize ( std::max ( want, 2 * m_rbuf.size() ) );
+	}
+
+      ssize_t status = read_some ( &m_rbuf[m_rend], m_rbuf.size() - m_rend );
+
+      if ( status == -1 )
+	return SocketError ( errno );
+
+      if ( status == 0 )
+	return false;
+
+      m_rend += status;
     }
+
+  return true;
 }
 
 
 
-bool Socket::connect ( const std::string host, const int port )
+SocketResult<void> Socket::connect ( const std::string host, const int port )
 {
-  if ( ! is_valid() ) return false;
+  if ( ! is_valid() ) return SocketError ( EBADF );
 
   m_addr.sin_family = AF_INET;
   m_addr.sin_port = htons ( port );
 
   int status = inet_pton ( AF_INET, host.c_str(), &m_addr.sin_addr );
 
-  if ( errno == EAFNOSUPPORT ) return false;
+  if ( errno == EAFNOSUPPORT ) return SocketError ( EAFNOSUPPORT );
 
   status = ::connect ( m_sock, ( sockaddr * ) &m_addr, sizeof ( m_addr ) );
 
-  if ( status == 0 )
-    return true;
-  else
+  if ( status == -1 )
+    return SocketError ( errno );
+
+  m_connected = true;
+  SocketMetrics::count ( SocketMetrics::CONNECTS );
+
+  return {};
+}
+
+ssize_t Socket::read_some ( char* buf, size_t len ) const
+{
+  ssize_t status;
+
+  do
+    {
+      uint64_t start = SocketMetrics::now();
+      status = ::recv ( m_sock, buf, len, 0 );
+      SocketMetrics::io ( SocketMetrics::RECV, start, status, len );
+    }
+  while ( status == -1 && errno == EINTR );
+
+  return status;
+}
+
+
+ssize_t Socket::write_some ( const char* buf, size_t len ) const
+{
+  ssize_t status;
+
+  do
+    {
+      uint64_t start = SocketMetrics::now();
+      status = ::send ( m_sock, buf, len, MSG_NOSIGNAL );
+      SocketMetrics::io ( SocketMetrics::SEND, start, status, len );
+    }
+  while ( status == -1 && errno == EINTR );
+
+  return status;
+}
+
+
+ssize_t Socket::write_some ( std::span<const iovec> iov ) const
+{
+  msghdr msg = msghdr();
+  msg.msg_iov = const_cast<iovec*> ( iov.data() );
+  msg.msg_iovlen = std::min ( iov.size(), ( size_t ) IOV_MAX );
+
+  ssize_t status;
+
+  do
+    {
+      uint64_t start = SocketMetrics::now();
+      status = ::sendmsg ( m_sock, &msg, MSG_NOSIGNAL );
+      SocketMetrics::io ( SocketMetrics::SEND, start, status, iov_bytes ( msg.msg_iov, msg.msg_iovlen ) );
+    }
+  while ( status == -1 && errno == EINTR );
+
+  return status;
+}
+
+
+// An idle connection is reusable only if the peer has neither closed it
+// nor sent anything unsolicited.
+bool Socket::is_alive() const
+{
+  if ( ! is_valid() || m_rend > m_rbegin )
     return false;
+
+  char c;
+  ssize_t status = ::recv ( m_sock, &c, 1, MSG_PEEK | MSG_DONTWAIT );
+
+  return status == -1 && ( errno == EAGAIN || errno == EWOULDBLOCK );
 }
 
+
 void Socket::set_non_blocking ( const bool b )
 {
 
@@ -189,3 +1195,126 @@ void Socket::set_non_blocking ( const bool b )
 	  F_SETFL,opts );
 
 }
+
+
+
+SocketResult<void> Socket::set_option ( int level, int name, int value )
+{
+  if ( setsockopt ( m_sock, level, name, &value, sizeof ( value ) ) == -1 )
+    return SocketError ( errno );
+
+  return {};
+}
+
+
+SocketResult<int> Socket::get_option ( int level, int name ) const
+{
+  int value = 0;
+  socklen_t len = sizeof ( value );
+
+  if ( getsockopt ( m_sock, level, name, &value, &len ) == -1 )
+    return SocketError ( errno );
+
+  return value;
+}
+
+
+SocketResult<void> Socket::set_no_delay ( const bool b )
+{
+  return set_option ( IPPROTO_TCP, TCP_NODELAY, b );
+}
+
+
+SocketResult<void> Socket::set_quick_ack ( const bool b )
+{
+  return set_option ( IPPROTO_TCP, TCP_QUICKACK, b );
+}
+
+
+SocketResult<void> Socket::set_tcp_cork ( const bool b )
+{
+  return set_option ( IPPROTO_TCP, TCP_CORK, b );
+}
+
+
+SocketResult<void> Socket::set_busy_poll ( const int usec )
+{
+  return set_option ( SOL_SOCKET, SO_BUSY_POLL, usec );
+}
+
+
+SocketResult<void> Socket::set_send_buffer ( const int bytes )
+{
+  return set_option ( SOL_SOCKET, SO_SNDBUF, bytes );
+}
+
+
+SocketResult<void> Socket::set_recv_buffer ( const int bytes )
+{
+  return set_option ( SOL_SOCKET, SO_RCVBUF, bytes );
+}
+
+
+SocketResult<int> Socket::send_buffer() const
+{
+  return get_option ( SOL_SOCKET, SO_SNDBUF );
+}
+
+
+SocketResult<int> Socket::recv_buffer() const
+{
+  return get_option ( SOL_SOCKET, SO_RCVBUF );
+}
+
+
+SocketResult<void> Socket::set_keep_alive ( const int idle_s, const int interval_s, const int count )
+{
+  SocketResult<void> r = set_option ( SOL_SOCKET, SO_KEEPALIVE, idle_s > 0 );
+
+  if ( ! r || idle_s <= 0 )
+    return r;
+
+  // Dead peers are found after idle + interval * count seconds, rather
+  // than the system default of over two hours.
+  if ( ! ( r = set_option ( IPPROTO_TCP, TCP_KEEPIDLE, idle_s ) ) )
+    return r;
+  if ( ! ( r = set_option ( IPPROTO_TCP, TCP_KEEPINTVL, interval_s ) ) )
+    return r;
+
+  return set_option ( IPPROTO_TCP, TCP_KEEPCNT, count );
+}
+
+
+SocketResult<void> Socket::set_profile ( const int profiles )
+{
+  SocketResult<void> r;
+
+  if ( profiles & PROFILE_LOW_LATENCY )
+    {
+      if ( ! ( r = set_no_delay ( true ) ) || ! ( r = set_quick_ack ( true ) ) )
+	return r;
+
+      // Above net.core.busy_read this needs CAP_NET_ADMIN; without it the
+      // socket simply does not busy poll.
+      r = set_busy_poll ( BUSY_POLL_USEC );
+      if ( ! r && r.error() != EPERM )
+	return r;
+    }
+
+  if ( profiles & PROFILE_BULK )
+    {
+      // No TCP_CORK: nothing here would ever clear it, and a corked
+      // reply waits out the 200ms cork timer. Senders batch with
+      // set_corked or set_tcp_cork around their own writes.
+      if ( ! ( r = set_send_buffer ( BULK_BUFFER ) ) || ! ( r = set_recv_buffer ( BULK_BUFFER ) ) )
+	return r;
+    }
+
+  if ( profiles & PROFILE_KEEPALIVE )
+    {
+      if ( ! ( r = set_keep_alive ( KEEPALIVE_IDLE ) ) )
+	return r;
+    }
+
+  return {};
+}
@@ -6,16 +6,43 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <netdb.h>
 #include <unistd.h>
+#include <span>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 #include <arpa/inet.h>
+#include "SocketResult.h"
 
 
 const int MAXHOSTNAME = 200;
 const int MAXCONNECTIONS = 5;
 const int MAXRECV = 500;
+const size_t MAXMESSAGE = 16 * 1024 * 1024;
+const size_t MAXCORK = 64 * 1024;
+const size_t ZEROCOPY_MIN = 64 * 1024;
+const size_t MAXPENDING = 1024 * 1024;
+const size_t MAXFDS = 64;
+const size_t READ_AHEAD = 16 * 1024;
+
+// Option sets for kinds of connection, for Socket::set_profile; combine
+// them with |.
+enum SocketProfile
+  {
+    PROFILE_LOW_LATENCY = 1,   // TCP_NODELAY, TCP_QUICKACK, SO_BUSY_POLL
+    PROFILE_BULK = 2,          // BULK_BUFFER send and receive buffers
+    PROFILE_KEEPALIVE = 4      // probes after KEEPALIVE_IDLE seconds of silence
+  };
+
+const int BUSY_POLL_USEC = 50;
+const int BULK_BUFFER = 4 * 1024 * 1024;
+const int KEEPALIVE_IDLE = 60;
+const int KEEPALIVE_INTERVAL = 10;
+const int KEEPALIVE_COUNT = 5;
 
 class Socket
 {
@@ -23,28 +50,183 @@ class Socket
   Socket();
   virtual ~Socket();
 
+  // Move-only: exactly one Socket owns the descriptor and closes it. A
+  // moved-from Socket is invalid, as if default-constructed; moving onto
+  // a live Socket closes what it held.
+  Socket ( Socket&& );
+  Socket& operator = ( Socket&& );
+
+  // Everything below reports failure with the errno that caused it,
+  // instead of throwing; see SocketResult.h.
+
   // Server initialization
-  bool create();
-  bool bind ( const int port );
-  bool listen() const;
-  bool accept ( Socket& ) const;
+  SocketResult<void> create();
+  SocketResult<void> set_reuse_port();
+  SocketResult<void> bind ( const int port );
+  SocketResult<void> listen ( const int backlog = MAXCONNECTIONS ) const;
+  SocketResult<void> accept ( Socket&, const bool non_blocking = false ) const;
 
   // Client initialization
-  bool connect ( const std::string host, const int port );
-
-  // Data Transimission
-  bool send ( const std::string ) const;
-  int recv ( std::string& ) const;
+  SocketResult<void> connect ( const std::string host, const int port );
+
+  // Local (AF_UNIX) stream sockets for same-host peers: the same stream
+  // API, without the TCP stack. A path starting with '@' names a socket
+  // in the abstract namespace, which leaves no file behind. bind_local
+  // replaces a stale socket file and the listener removes it when closed.
+  SocketResult<void> create_local();
+  SocketResult<void> bind_local ( const std::string& path );
+  SocketResult<void> connect_local ( const std::string& path );
+
+  // Data Transimission - receives return the byte count, 0 on orderly
+  // shutdown. On a non-blocking socket a send is either taken whole, or
+  // fails with EAGAIN having taken nothing, so retrying it never sends
+  // anything twice. What the kernel had no room for is kept and goes
+  // out, in order, with the next send or flush(); pending() counts it.
+  // A send fails with EAGAIN when the socket takes none of it, or while
+  // MAXPENDING or more bytes are still kept.
+  SocketResult<void> send ( const std::string& ) const;
+  SocketResult<size_t> recv ( std::string& ) const;
+
+  // Receive into caller-owned memory, without the copy through a string.
+  // The string_view overload points into the socket's own receive buffer
+  // and stays valid until the next receive on this socket.
+  SocketResult<size_t> recv ( std::span<char> ) const;
+  SocketResult<size_t> recv ( std::string_view& ) const;
+  SocketResult<void> send ( std::span<const char> ) const;
+
+  // Gather send - every buffer goes out through sendmsg, as few calls as
+  // the kernel allows.
+  SocketResult<void> send ( std::span<const iovec> ) const;
+
+  // While corked, sends collect in a buffer and go out in one call on
+  // flush(), when it reaches MAXCORK bytes, or when uncorked.
+  SocketResult<void> set_corked ( const bool );
+  SocketResult<void> flush() const;
+  size_t pending() const { return m_wbuf.size(); }
+
+  // Framed messages - a 4 byte big-endian length followed by the payload.
+  // Bytes read past the end of a message stay buffered for the next call.
+  // recv_message yields false if the peer closed between messages;
+  // closing part way through one is ECONNRESET.
+  SocketResult<void> send_message ( const std::string& ) const;
+  SocketResult<bool> recv_message ( std::string& ) const;
+
+  // Pipelined messages: recv_messages waits for at least one message, then
+  // yields every complete one already read, as views into the receive
+  // buffer that stay valid until the next receive; 0 on a clean close.
+  // send_messages frames a whole batch into one gathered write.
+  SocketResult<size_t> recv_messages ( std::vector<std::string_view>& ) const;
+  SocketResult<void> send_messages ( std::span<const std::string_view> ) const;
+
+  // Descriptor passing over local sockets (SCM_RIGHTS). The descriptors
+  // travel with the data, which must not be empty; received ones are
+  // close-on-exec and owned by the caller. At most MAXFDS per call. Bytes
+  // already buffered by recv_message have lost any descriptors sent with
+  // them, so don't mix the two on one stream.
+  SocketResult<void> send_fds ( std::string_view, std::span<const int> ) const;
+  SocketResult<size_t> recv_fds ( std::span<char>, std::vector<int>& ) const;
+
+
+  // Zero-copy bulk sends. send_file moves count bytes of a file from
+  // offset straight to the socket with sendfile, or through a pipe with
+  // splice when the source is a pipe or socket; returns the bytes sent,
+  // fewer only at end of file.
+  SocketResult<size_t> send_file ( int fd, off_t offset, size_t count ) const;
+
+  // MSG_ZEROCOPY: the kernel sends from the caller's pages instead of
+  // copying them, so the buffer must stay untouched until the returned
+  // ticket is done. Below ZEROCOPY_MIN, where pinning the pages and
+  // collecting the completion cost more than the copy, or before
+  // enable_zerocopy succeeds, this is an ordinary send whose ticket is
+  // done once the zero-copy sends before it are. Completions are collected from the error queue by
+  // zerocopy_done and wait_zerocopy.
+  SocketResult<void> enable_zerocopy();
+  SocketResult<uint32_t> send_zerocopy ( std::span<const char> ) const;
+  bool zerocopy_done ( uint32_t ticket ) const;
+  SocketResult<void> wait_zerocopy ( uint32_t ticket ) const;
+
+  // Sends the kernel completed by copying after all (loopback does).
+  size_t zerocopy_copied() const { return m_zc_copied; }
+
+
+  // Non-blocking I/O - return the byte count, 0 on orderly shutdown (reads),
+  // or -1 with errno set (EAGAIN/EWOULDBLOCK when the call would block).
+  ssize_t read_some ( char*, size_t ) const;
+  ssize_t write_some ( const char*, size_t ) const;
+  ssize_t write_some ( std::span<const iovec> ) const;
 
 
   void set_non_blocking ( const bool );
 
+  // Typed socket options, one setsockopt each. TCP_QUICKACK is not
+  // sticky: the stack falls back to delayed ACKs on its own. Under
+  // TCP_CORK only full segments leave until it is cleared, so a corked
+  // sender uncorks after its last write. The kernel doubles buffer
+  // sizes and caps them at net.core.wmem_max/rmem_max; send_buffer and
+  // recv_buffer read back what it applied. Fixing a buffer size turns
+  // off the kernel's autotuning for it. An idle of 0 turns keepalive off.
+  SocketResult<void> set_no_delay ( const bool );
+  SocketResult<void> set_quick_ack ( const bool );
+  SocketResult<void> set_tcp_cork ( const bool );
+  SocketResult<void> set_busy_poll ( const int usec );
+  SocketResult<void> set_send_buffer ( const int bytes );
+  SocketResult<void> set_recv_buffer ( const int bytes );
+  SocketResult<void> set_keep_alive ( const int idle_s, const int interval_s = KEEPALIVE_INTERVAL, const int count = KEEPALIVE_COUNT );
+  SocketResult<int> send_buffer() const;
+  SocketResult<int> recv_buffer() const;
+
+  // Applies the SocketProfile options; stops at the first failure.
+  // Busy polling is left out where the host does not allow it.
+  SocketResult<void> set_profile ( const int profiles );
+
+  // Exchanges everything, descriptor and buffers, with another socket.
+  void swap ( Socket& );
+
   bool is_valid() const { return m_sock != -1; }
+  bool is_alive() const;
+  int fd() const { return m_sock; }
 
  private:
 
+  Socket ( const Socket& ) = delete;
+  Socket& operator = ( const Socket& ) = delete;
+
+  SocketResult<bool> fill_buffer ( size_t need ) const;
+  SocketResult<bool> next_message ( uint32_t& len ) const;
+  SocketResult<void> send_all ( const iovec*, size_t count ) const;
+  SocketResult<void> make_room() const;
+  SocketResult<size_t> send_some ( const iovec*, size_t count, int flags = 0 ) const;
+  SocketResult<size_t> splice_file ( int fd, size_t count ) const;
+  void reap_zerocopy() const;
+  SocketResult<void> set_option ( int level, int name, int value );
+  SocketResult<int> get_option ( int level, int name ) const;
+
   int m_sock;
   sockaddr_in m_addr;
+  std::string m_path;   // socket file created by bind_local
+  bool m_connected;     // accepted or connected, for SocketMetrics
+
+  // Receive buffer shared by recv and recv_message; [m_rbegin, m_rend) is
+  // unread data.
+  mutable std::vector<char> m_rbuf;
+  mutable size_t m_rbegin;
+  mutable size_t m_rend;
+
+  bool m_corked;
+  mutable std::string m_wbuf;
+
+  // Scratch for send_messages, kept so steady-state batches don't
+  // allocate.
+  mutable std::vector<uint32_t> m_lens;
+  mutable std::vector<iovec> m_iov;
+
+  // Zero-copy sends are numbered from 0; every id below m_zc_done has
+  // completed, and m_zc_ranges holds completions that arrived early.
+  bool m_zerocopy;
+  mutable uint32_t m_zc_next;
+  mutable uint32_t m_zc_done;
+  mutable std::vector<std::pair<uint32_t, uint32_t> > m_zc_ranges;
+  mutable size_t m_zc_copied;
 
 
 };
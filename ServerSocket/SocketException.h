@@ -9,14 +9,18 @@
 class SocketException
 {
  public:
-  SocketException ( std::string s ) : m_s ( s ) {};
+  SocketException ( std::string s, int code = 0 ) : m_s ( s ), m_code ( code ) {};
   ~SocketException (){};
 
   std::string description() { return m_s; }
 
+  // The errno behind the failure; 0 if the peer closed the connection.
+  int code() const { return m_code; }
+
  private:
 
   std::string m_s;
+  int m_code;
 
 };
 
@@ -0,0 +1,206 @@
+// Implementation of the SocketMetrics class
+
+#include "SocketMetrics.h"
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+
+// Every live thread's block, plus the totals of threads that have exited.
+struct SocketMetrics::Registry
+{
+  std::mutex lock;
+  std::vector<Block*> blocks;
+  Block retired;
+  size_t threads;
+};
+
+// Folds a thread's block into the retired totals when the thread exits.
+struct SocketMetrics::Detacher
+{
+  ~Detacher();
+};
+
+
+SocketMetrics::Registry& SocketMetrics::registry()
+{
+  // Never destroyed, so threads that outlive main can still detach.
+  static Registry* r = new Registry();
+  return *r;
+}
+
+
+SocketMetrics::Block* SocketMetrics::attach()
+{
+  static thread_local Detacher detacher;
+  ( void ) detacher;
+
+  // Called between a syscall and the errno check that follows it.
+  int saved = errno;
+
+  Registry& r = registry();
+  Block* b = new Block();
+
+  {
+    std::lock_guard<std::mutex> guard ( r.lock );
+    r.blocks.push_back ( b );
+    r.threads++;
+  }
+
+  t_block = b;
+  errno = saved;
+
+  return b;
+}
+
+
+SocketMetrics::Detacher::~Detacher()
+{
+  Block* b = t_block;
+
+  if ( ! b )
+    return;
+
+  Registry& r = registry();
+  std::lock_guard<std::mutex> guard ( r.lock );
+
+  for ( size_t i = 0; i < COUNTERS; i++ )
+    bump ( r.retired.counters[i], b->counters[i].load ( std::memory_order_relaxed ) );
+
+  for ( size_t d = 0; d < 2; d++ )
+    for ( size_t i = 0; i < HISTOGRAM_BUCKETS; i++ )
+      bump ( r.retired.latency[d][i], b->latency[d][i].load ( std::memory_order_relaxed ) );
+
+  for ( size_t i = 0; i < r.blocks.size(); i++ )
+    if ( r.blocks[i] == b )
+      {
+	r.blocks[i] = r.blocks.back();
+	r.blocks.pop_back();
+	break;
+      }
+
+  t_block = 0;
+  delete b;
+}
+
+
+SocketMetrics::Snapshot SocketMetrics::snapshot()
+{
+  Snapshot s;
+  Registry& r = registry();
+
+  std::lock_guard<std::mutex> guard ( r.lock );
+
+  std::vector<const Block*> blocks ( r.blocks.begin(), r.blocks.end() );
+  blocks.push_back ( &r.retired );
+
+  for ( size_t i = 0; i < COUNTERS; i++ )
+    {
+      s.counters[i] = 0;
+      for ( const Block* b : blocks )
+	s.counters[i] += b->counters[i].load ( std::memory_order_relaxed );
+    }
+
+  // Bucket counts only, so sums and maxima come out at bucket midpoints.
+  for ( size_t d = 0; d < 2; d++ )
+    for ( size_t i = 0; i < HISTOGRAM_BUCKETS; i++ )
+      {
+	uint64_t n = 0;
+	for ( const Block* b : blocks )
+	  n += b->latency[d][i].load ( std::memory_order_relaxed );
+	s.latency[d].record ( LatencyHistogram::bucket_value ( i ), n );
+      }
+
+  s.active = ( int64_t ) ( s.counters[ACCEPTS] + s.counters[CONNECTS] ) - ( int64_t ) s.counters[CLOSES];
+  s.threads = r.threads;
+
+  return s;
+}
+
+
+const char* SocketMetrics::name ( Counter c )
+{
+  static const char* names[COUNTERS] =
+    {
+      "bytes_in",
+      "bytes_out",
+      "recv_calls",
+      "send_calls",
+      "accept_calls",
+      "eagains",
+      "partial_writes",
+      "accepts",
+      "connects",
+      "closes"
+    };
+
+  return names[c];
+}
+
+
+static const char* directions[2] = { "recv", "send" };
+
+
+std::string SocketMetrics::text()
+{
+  std::ostringstream out;
+
+  if ( ! enabled() )
+    return "metrics disabled\n";
+
+  Snapshot s = snapshot();
+
+  for ( size_t i = 0; i < COUNTERS; i++ )
+    out << name ( ( Counter ) i ) << " " << s.counters[i] << "\n";
+
+  out << "active " << s.active << "\n"
+      << "threads " << s.threads << "\n";
+
+  for ( size_t d = 0; d < 2; d++ )
+    {
+      const LatencyHistogram& h = s.latency[d];
+      out << directions[d] << "_latency_ns count " << h.count()
+	  << " mean " << ( uint64_t ) h.mean()
+	  << " p50 " << h.percentile ( 0.5 )
+	  << " p99 " << h.percentile ( 0.99 )
+	  << " p999 " << h.percentile ( 0.999 )
+	  << " max " << h.max() << "\n";
+    }
+
+  return out.str();
+}
+
+
+std::string SocketMetrics::json()
+{
+  std::ostringstream out;
+
+  out << "{\"enabled\":" << ( enabled() ? "true" : "false" );
+
+  if ( enabled() )
+    {
+      Snapshot s = snapshot();
+
+      for ( size_t i = 0; i < COUNTERS; i++ )
+	out << ",\"" << name ( ( Counter ) i ) << "\":" << s.counters[i];
+
+      out << ",\"active\":" << s.active
+	  << ",\"threads\":" << s.threads;
+
+      for ( size_t d = 0; d < 2; d++ )
+	{
+	  const LatencyHistogram& h = s.latency[d];
+	  out << ",\"" << directions[d] << "_latency_ns\":{"
+	      << "\"count\":" << h.count()
+	      << ",\"mean\":" << ( uint64_t ) h.mean()
+	      << ",\"p50\":" << h.percentile ( 0.5 )
+	      << ",\"p99\":" << h.percentile ( 0.99 )
+	      << ",\"p999\":" << h.percentile ( 0.999 )
+	      << ",\"max\":" << h.max() << "}";
+	}
+    }
+
+  out << "}\n";
+
+  return out.str();
+}
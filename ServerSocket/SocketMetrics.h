@@ -0,0 +1,139 @@
+// Definition of the SocketMetrics class
+
+#ifndef SocketMetrics_class
+#define SocketMetrics_class
+
+#include "LatencyHistogram.h"
+#include <errno.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <time.h>
+#include <atomic>
+#include <string>
+
+
+// Build with -DSOCKET_METRICS=0 (make METRICS=0) and every hook below is
+// an empty inline function: no counters, no clock reads.
+#ifndef SOCKET_METRICS
+#define SOCKET_METRICS 1
+#endif
+
+// Counters for what the Socket layer does: bytes, syscalls, EAGAINs,
+// partial writes, accepts and live connections, plus the time spent in
+// each recv and send syscall. Every thread bumps its own block with plain
+// relaxed stores - no locks, no shared cache lines - and snapshot() adds
+// the blocks up on demand. A thread's counts outlive the thread.
+class SocketMetrics
+{
+ public:
+
+  enum Counter
+    {
+      BYTES_IN,
+      BYTES_OUT,
+      RECV_CALLS,
+      SEND_CALLS,
+      ACCEPT_CALLS,
+      EAGAINS,
+      PARTIAL_WRITES,
+      ACCEPTS,
+      CONNECTS,
+      CLOSES,
+      COUNTERS
+    };
+
+  enum Direction { RECV, SEND };
+
+  struct Snapshot
+  {
+    uint64_t counters[COUNTERS];
+    int64_t active;                  // accepts + connects - closes
+    size_t threads;                  // that have touched a socket
+    LatencyHistogram latency[2];     // nanoseconds, by Direction
+  };
+
+  static bool enabled() { return SOCKET_METRICS; }
+
+  // Hot path hooks, called from Socket.
+  static uint64_t now();
+  static void count ( Counter, uint64_t n = 1 );
+
+  // Accounts for one recv or send style syscall that began at start,
+  // asked for len bytes and returned status; errno is left alone.
+  static void io ( Direction, uint64_t start, ssize_t status, size_t len );
+
+  static Snapshot snapshot();
+  static const char* name ( Counter );
+
+  // One "name value" line per figure, or a single JSON object.
+  static std::string text();
+  static std::string json();
+
+ private:
+
+  struct alignas ( 64 ) Block
+  {
+    std::atomic<uint64_t> counters[COUNTERS];
+    std::atomic<uint64_t> latency[2][HISTOGRAM_BUCKETS];
+  };
+
+  struct Registry;
+  struct Detacher;
+
+  static Registry& registry();
+  static Block* attach();
+  static void bump ( std::atomic<uint64_t>& c, uint64_t n )
+  {
+    // Only the owning thread writes, so no read-modify-write is needed.
+    c.store ( c.load ( std::memory_order_relaxed ) + n, std::memory_order_relaxed );
+  }
+
+  static inline thread_local Block* t_block = 0;
+
+};
+
+
+#if SOCKET_METRICS
+
+inline uint64_t SocketMetrics::now()
+{
+  timespec ts;
+  clock_gettime ( CLOCK_MONOTONIC, &ts );
+  return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+inline void SocketMetrics::count ( Counter c, uint64_t n )
+{
+  Block* b = t_block ? t_block : attach();
+  bump ( b->counters[c], n );
+}
+
+inline void SocketMetrics::io ( Direction d, uint64_t start, ssize_t status, size_t len )
+{
+  uint64_t elapsed = now() - start;
+  Block* b = t_block ? t_block : attach();
+
+  bump ( b->counters[d == RECV ? RECV_CALLS : SEND_CALLS], 1 );
+  bump ( b->latency[d][LatencyHistogram::bucket ( elapsed )], 1 );
+
+  if ( status > 0 )
+    {
+      bump ( b->counters[d == RECV ? BYTES_IN : BYTES_OUT], status );
+
+      if ( d == SEND && ( size_t ) status < len )
+	bump ( b->counters[PARTIAL_WRITES], 1 );
+    }
+  else if ( status == -1 && ( errno == EAGAIN || errno == EWOULDBLOCK ) )
+    bump ( b->counters[EAGAINS], 1 );
+}
+
+#else
+
+inline uint64_t SocketMetrics::now() { return 0; }
+inline void SocketMetrics::count ( Counter, uint64_t ) {}
+inline void SocketMetrics::io ( Direction, uint64_t, ssize_t, size_t ) {}
+
+#endif
+
+
+#endif
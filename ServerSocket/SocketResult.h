@@ -0,0 +1,87 @@
+// SocketResult class
+
+
+#ifndef SocketResult_class
+#define SocketResult_class
+
+#include <errno.h>
+#include <string.h>
+#include <string>
+#include <utility>
+
+
+// The errno of a failed call, for building a failed result:
+//
+//   return SocketError ( errno );
+struct SocketError
+{
+  explicit SocketError ( int e ) : code ( e ) {};
+
+  int code;
+};
+
+
+// Either a value or the errno of the failure, in the manner of
+// std::expected<T, int>. Nothing is allocated on either path, so failures
+// that are routine (peer gone, would block) cost no more than success.
+//
+//   SocketResult<size_t> n = sock.try_recv ( data );
+//   if ( ! n )
+//     log ( n.message() );
+//   else if ( *n == 0 )
+//     ...  // orderly shutdown
+template <class T>
+class SocketResult
+{
+ public:
+
+  SocketResult ( const T& v ) : m_value ( v ), m_error ( 0 ) {};
+  SocketResult ( T&& v ) : m_value ( std::move ( v ) ), m_error ( 0 ) {};
+  SocketResult ( SocketError e ) : m_value(), m_error ( e.code ? e.code : EIO ) {};
+
+  bool ok() const { return m_error == 0; }
+  explicit operator bool() const { return ok(); }
+
+  const T& value() const { return m_value; }
+  const T& operator * () const { return m_value; }
+
+  // Mutable access, so a move-only value can be taken out:
+  //   ServerSocket conn = std::move ( *r );
+  T& value() { return m_value; }
+  T& operator * () { return m_value; }
+  T* operator -> () { return &m_value; }
+  const T* operator -> () const { return &m_value; }
+
+  int error() const { return m_error; }
+  std::string message() const { return strerror ( m_error ); }
+
+ private:
+
+  T m_value;
+  int m_error;
+
+};
+
+
+template <>
+class SocketResult<void>
+{
+ public:
+
+  SocketResult() : m_error ( 0 ) {};
+  SocketResult ( SocketError e ) : m_error ( e.code ? e.code : EIO ) {};
+
+  bool ok() const { return m_error == 0; }
+  explicit operator bool() const { return ok(); }
+
+  int error() const { return m_error; }
+  std::string message() const { return strerror ( m_error ); }
+
+ private:
+
+  int m_error;
+
+};
+
+
+#endif
@@ -0,0 +1,268 @@
+// Implementation of the SpliceProxy class
+
+#include "SpliceProxy.h"
+#include "SocketException.h"
+#include <sys/socket.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+SpliceProxy::Session::~Session()
+{
+  for ( int i = 0; i < 2; i++ )
+    if ( flows[i].pipe[0] != -1 )
+      {
+	::close ( flows[i].pipe[0] );
+	::close ( flows[i].pipe[1] );
+      }
+}
+
+
+SpliceProxy::SpliceProxy ( ServerSocket& listener, std::string host, int port, bool splice ) :
+  m_listener ( listener ),
+  m_host ( host ),
+  m_port ( port ),
+  m_splice ( splice )
+{
+  m_closed.upstream = m_closed.downstream = 0;
+
+  m_listener.set_non_blocking ( true );
+
+  if ( ! m_loop.add ( m_listener.fd(), [this] { on_accept(); } ) )
+    {
+      throw SocketException ( "Could not watch listening socket." );
+    }
+
+  m_accept_timer.set_callback ( [this] { m_loop.set_read_interest ( m_listener.fd(), true ); } );
+}
+
+SpliceProxy::~SpliceProxy()
+{
+  m_loop.remove ( m_listener.fd() );
+
+  for ( auto& s : m_sessions )
+    {
+      m_loop.remove ( s.second->down.fd() );
+      m_loop.remove ( s.second->up.fd() );
+    }
+}
+
+
+bool SpliceProxy::stats ( int fd, ProxyStats& st ) const
+{
+  auto it = m_sessions.find ( fd );
+
+  if ( it == m_sessions.end() )
+    return false;
+
+  st.upstream = it->second->flows[0].bytes;
+  st.downstream = it->second->flows[1].bytes;
+
+  return true;
+}
+
+
+ProxyStats SpliceProxy::totals() const
+{
+  ProxyStats t = m_closed;
+
+  for ( auto& s : m_sessions )
+    {
+      t.upstream += s.second->flows[0].bytes;
+      t.downstream += s.second->flows[1].bytes;
+    }
+
+  return t;
+}
+
+
+bool SpliceProxy::open_flow ( Flow& f, int src, int dst )
+{
+  f.src = src;
+  f.dst = dst;
+  f.pipe[0] = f.pipe[1] = -1;
+  f.off = f.pending = 0;
+  f.eof = false;
+  f.bytes = 0;
+
+  if ( ! m_splice )
+    {
+      f.buf.resize ( PROXY_PIPE_SIZE );
+      return true;
+    }
+
+  if ( ::pipe2 ( f.pipe, O_NONBLOCK | O_CLOEXEC ) == -1 )
+    return false;
+
+  // A bigger pipe means fewer splice calls per megabyte; the default
+  // 64KB still works if the limit is lower.
+  fcntl ( f.pipe[1], F_SETPIPE_SZ, ( int ) PROXY_PIPE_SIZE );
+
+  return true;
+}
+
+
+void SpliceProxy::on_accept()
+{
+  while ( true )
+    {
+      SocketResult<ServerSocket> conn = m_listener.try_accept ( true );
+
+      if ( ! conn && accept_retry_now ( conn.error() ) )
+	continue;
+
+      if ( ! conn )
+	{
+	  // Out of descriptors or memory: pause rather than spin on a
+	  // listener that stays readable.
+	  if ( conn.error() != EAGAIN && conn.error() != EWOULDBLOCK )
+	    {
+	      m_loop.set_read_interest ( m_listener.fd(), false );
+	      m_loop.timers().arm ( m_accept_timer, ACCEPT_BACKOFF_MS );
+	    }
+	  return;
+	}
+
+      std::unique_ptr<Session> s ( new Session );
+      s->down = std::move ( *conn );
+      s->flows[0].pipe[0] = s->flows[1].pipe[0] = -1;
+
+      if ( ! s->up.try_connect ( m_host, m_port ) )
+	continue;
+
+      s->up.set_non_blocking ( true );
+
+      int down = s->down.fd();
+      int up = s->up.fd();
+
+      if ( ! open_flow ( s->flows[0], down, up ) || ! open_flow ( s->flows[1], up, down ) )
+	continue;
+
+      // Each socket is the source of one flow and the destination of the
+      // other: readable feeds the first, writable drains the second.
+      if ( ! m_loop.add ( down, [this, down] { pump ( down, 0 ); }, [this, down] { pump ( down, 1 ); } ) )
+	continue;
+
+      if ( ! m_loop.add ( up, [this, down] { pump ( down, 1 ); }, [this, down] { pump ( down, 0 ); } ) )
+	{
+	  m_loop.remove ( down );
+	  continue;
+	}
+
+      m_sessions[down] = std::move ( s );
+    }
+}
+
+
+void SpliceProxy::pump ( int key, int flow )
+{
+  auto it = m_sessions.find ( key );
+
+  if ( it == m_sessions.end() )
+    return;
+
+  Flow& f = it->second->flows[flow];
+
+  // Once a source has ended, only an error can wake it again.
+  if ( f.eof )
+    {
+      int err = 0;
+      socklen_t len = sizeof ( err );
+      if ( getsockopt ( f.src, SOL_SOCKET, SO_ERROR, &err, &len ) == -1 || err )
+	close ( key );
+      return;
+    }
+
+  while ( true )
+    {
+      ssize_t n;
+
+      if ( f.pending > 0 )
+	{
+	  if ( m_splice )
+	    n = ::splice ( f.pipe[0], 0, f.dst, 0, f.pending, SPLICE_F_MOVE | SPLICE_F_NONBLOCK );
+	  else
+	    n = ::send ( f.dst, &f.buf[f.off], f.pending, MSG_NOSIGNAL );
+
+	  if ( n == -1 && errno == EINTR )
+	    continue;
+
+	  // Destination full: stop reading the source until it drains.
+	  if ( n == -1 && ( errno == EAGAIN || errno == EWOULDBLOCK ) )
+	    {
+	      m_loop.set_write_interest ( f.dst, true );
+	      m_loop.set_read_interest ( f.src, false );
+	      return;
+	    }
+
+	  if ( n == -1 )
+	    {
+	      close ( key );
+	      return;
+	    }
+
+	  f.pending -= n;
+	  f.off += n;
+	  f.bytes += n;
+	  continue;
+	}
+
+      m_loop.set_write_interest ( f.dst, false );
+      m_loop.set_read_interest ( f.src, true );
+
+      if ( m_splice )
+	n = ::splice ( f.src, 0, f.pipe[1], 0, PROXY_PIPE_SIZE, SPLICE_F_MOVE | SPLICE_F_NONBLOCK );
+      else
+	n = ::recv ( f.src, &f.buf[0], f.buf.size(), 0 );
+
+      if ( n == -1 && errno == EINTR )
+	continue;
+
+      if ( n == -1 && ( errno == EAGAIN || errno == EWOULDBLOCK ) )
+	return;
+
+      if ( n == -1 )
+	{
+	  close ( key );
+	  return;
+	}
+
+      if ( n == 0 )
+	{
+	  // Everything read has been delivered, so pass the half-close on.
+	  f.eof = true;
+	  m_loop.set_read_interest ( f.src, false );
+	  ::shutdown ( f.dst, SHUT_WR );
+
+	  if ( it->second->flows[1 - flow].eof )
+	    close ( key );
+	  return;
+	}
+
+      f.pending = n;
+      f.off = 0;
+    }
+}
+
+
+void SpliceProxy::close ( int key )
+{
+  auto it = m_sessions.find ( key );
+
+  if ( it == m_sessions.end() )
+    return;
+
+  Session& s = *it->second;
+  ProxyStats st = { s.flows[0].bytes, s.flows[1].bytes };
+
+  m_closed.upstream += st.upstream;
+  m_closed.downstream += st.downstream;
+
+  m_loop.remove ( s.down.fd() );
+  m_loop.remove ( s.up.fd() );
+  m_sessions.erase ( it );
+
+  if ( m_on_close )
+    m_on_close ( key, st );
+}
@@ -0,0 +1,105 @@
+// Definition of the SpliceProxy class
+
+#ifndef SpliceProxy_class
+#define SpliceProxy_class
+
+#include "ServerSocket.h"
+#include "ClientSocket.h"
+#include "EventLoop.h"
+#include <stdint.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+const size_t PROXY_PIPE_SIZE = 256 * 1024;
+
+// Bytes moved for one proxied connection.
+struct ProxyStats
+{
+  uint64_t upstream;     // client to server
+  uint64_t downstream;   // server to client
+};
+
+// Forwards every connection accepted on a listener to an upstream server,
+// from one EventLoop. Each direction moves data socket -> pipe -> socket
+// with splice, so payload bytes never enter user space. In copy mode the
+// same loop relays through a user-space buffer with recv and send, which
+// is what the splice mode is measured against.
+//
+// A half-close is passed on: when one side stops sending, the other side
+// sees a shutdown once everything before it has been delivered. The
+// upstream connect is blocking, which suits a forwarding tier in front of
+// nearby servers.
+class SpliceProxy
+{
+ public:
+
+  typedef std::function<void ( int fd, const ProxyStats& )> CloseHandler;
+
+  SpliceProxy ( ServerSocket& listener, std::string host, int port, bool splice = true );
+  virtual ~SpliceProxy();
+
+  void run() { m_loop.run(); }
+  void stop() { m_loop.stop(); }
+
+  // Called with the final counters as each connection ends.
+  void on_close ( CloseHandler h ) { m_on_close = h; }
+
+  // Live counters for the connection accepted as fd, if still open.
+  bool stats ( int fd, ProxyStats& ) const;
+
+  // Over every connection, closed or open.
+  ProxyStats totals() const;
+
+  EventLoop& loop() { return m_loop; }
+  size_t connections() const { return m_sessions.size(); }
+
+ private:
+
+  SpliceProxy ( const SpliceProxy& );
+  SpliceProxy& operator = ( const SpliceProxy& );
+
+  // One direction of a connection.
+  struct Flow
+  {
+    int src;
+    int dst;
+    int pipe[2];              // splice mode
+    std::vector<char> buf;    // copy mode
+    size_t off;
+    size_t pending;           // read from src, not yet written to dst
+    bool eof;
+    uint64_t bytes;
+  };
+
+  struct Session
+  {
+    ServerSocket down;
+    ClientSocket up;
+    Flow flows[2];            // 0: down -> up, 1: up -> down
+    ~Session();
+  };
+
+  void on_accept();
+  bool open_flow ( Flow&, int src, int dst );
+  void pump ( int key, int flow );
+  void close ( int key );
+
+  ServerSocket& m_listener;
+  std::string m_host;
+  int m_port;
+  bool m_splice;
+  EventLoop m_loop;
+  TimerWheel::Timer m_accept_timer;   // resumes accepting after a backoff
+  CloseHandler m_on_close;
+
+  std::unordered_map<int, std::unique_ptr<Session> > m_sessions;
+  ProxyStats m_closed;
+
+};
+
+
+#endif
@@ -0,0 +1,50 @@
+// Definition of the Task coroutine type
+
+#ifndef Task_class
+#define Task_class
+
+#include "SocketException.h"
+#include <coroutine>
+#include <exception>
+#include <iostream>
+
+
+// A detached coroutine: it starts running as soon as it is called and
+// frees itself when it finishes. Connection handlers are written as Tasks
+// and suspend on AsyncSocket operations, which report failure through
+// SocketResult. Nothing is left to rethrow to once a Task is detached, so
+// an exception escaping one is a bug: it is reported and the process
+// terminates, rather than the connection silently going quiet.
+class Task
+{
+ public:
+
+  struct promise_type
+  {
+    Task get_return_object() { return Task(); }
+    std::suspend_never initial_suspend() noexcept { return std::suspend_never(); }
+    std::suspend_never final_suspend() noexcept { return std::suspend_never(); }
+    void return_void() {}
+
+    // The terminate handler names the exception, with what() for a
+    // std::exception; a SocketException's description is printed first.
+    void unhandled_exception() noexcept
+    {
+      try
+	{
+	  throw;
+	}
+      catch ( SocketException& e )
+	{
+	  std::cerr << "Exception escaped a Task:" << e.description() << "\n";
+	}
+      catch ( ... ) {}
+
+      std::terminate();
+    }
+  };
+
+};
+
+
+#endif
@@ -0,0 +1,164 @@
+// Implementation of the ThreadPoolServer class
+
+#include "ThreadPoolServer.h"
+#include "SocketException.h"
+#include <sys/socket.h>
+#include <algorithm>
+#include <chrono>
+#include <exception>
+
+
+ThreadPoolServer::ThreadPoolServer ( ServerSocket& listener,
+				     Handler handler,
+				     size_t threads,
+				     size_t queue_size,
+				     OverloadPolicy policy ) :
+  m_listener ( listener ),
+  m_handler ( handler ),
+  m_queue_size ( queue_size > 0 ? queue_size : 1 ),
+  m_policy ( policy ),
+  m_running ( true )
+{
+  if ( threads == 0 )
+    threads = std::thread::hardware_concurrency();
+
+  if ( threads == 0 )
+    threads = 1;
+
+  for ( size_t i = 0; i < threads; i++ )
+    m_workers.push_back ( std::thread ( &ThreadPoolServer::work, this ) );
+}
+
+ThreadPoolServer::~ThreadPoolServer()
+{
+  stop();
+
+  for ( size_t i = 0; i < m_workers.size(); i++ )
+    m_workers[i].join();
+}
+
+
+void ThreadPoolServer::run()
+{
+  while ( true )
+    {
+      SocketResult<ServerSocket> sock = m_listener.try_accept();
+
+      if ( ! sock )
+	{
+	  {
+	    std::lock_guard<std::mutex> lock ( m_mutex );
+	    if ( ! m_running )
+	      return;
+	  }
+
+	  // Out of descriptors or memory: wait for some to free up.
+	  if ( ! accept_retry_now ( sock.error() ) )
+	    std::this_thread::sleep_for ( std::chrono::milliseconds ( ACCEPT_BACKOFF_MS ) );
+	  continue;
+	}
+
+      if ( ! enqueue ( std::move ( *sock ) ) )
+	return;
+    }
+}
+
+
+void ThreadPoolServer::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock ( m_mutex );
+    if ( ! m_running )
+      return;
+    m_running = false;
+
+    // Handlers blocked on a connection see it end, and queued ones are
+    // finished as soon as a worker takes them. A worker closes its fd
+    // only after dropping it from m_active, so none has been reused.
+    for ( size_t i = 0; i < m_active.size(); i++ )
+      ::shutdown ( m_active[i], SHUT_RDWR );
+
+    for ( size_t i = 0; i < m_queue.size(); i++ )
+      ::shutdown ( m_queue[i].fd(), SHUT_RDWR );
+  }
+
+  // Wakes an acceptor blocked in accept(); it then sees m_running.
+  ::shutdown ( m_listener.fd(), SHUT_RDWR );
+
+  m_not_empty.notify_all();
+  m_not_full.notify_all();
+}
+
+
+bool ThreadPoolServer::enqueue ( ServerSocket&& sock )
+{
+  // Connections closed under the REJECT and DROP_OLDEST policies are
+  // destroyed after the lock is released.
+  ServerSocket dropped;
+
+  std::unique_lock<std::mutex> lock ( m_mutex );
+
+  if ( m_queue.size() >= m_queue_size )
+    {
+      switch ( m_policy )
+	{
+	case OVERLOAD_BLOCK:
+	  m_not_full.wait ( lock, [this] { return m_queue.size() < m_queue_size || ! m_running; } );
+	  break;
+
+	case OVERLOAD_REJECT:
+	  dropped = std::move ( sock );
+	  return m_running;
+
+	case OVERLOAD_DROP_OLDEST:
+	  dropped = std::move ( m_queue.front() );
+	  m_queue.pop_front();
+	  break;
+	}
+    }
+
+  if ( ! m_running )
+    return false;
+
+  m_queue.push_back ( std::move ( sock ) );
+  m_not_empty.notify_one();
+
+  return true;
+}
+
+
+void ThreadPoolServer::work()
+{
+  while ( true )
+    {
+      ServerSocket sock;
+      int fd;
+
+      {
+	std::unique_lock<std::mutex> lock ( m_mutex );
+	m_not_empty.wait ( lock, [this] { return ! m_queue.empty() || ! m_running; } );
+
+	if ( m_queue.empty() )
+	  return;
+
+	sock = std::move ( m_queue.front() );
+	m_queue.pop_front();
+	fd = sock.fd();
+	m_active.push_back ( fd );
+      }
+
+      m_not_full.notify_one();
+
+      try
+	{
+	  m_handler ( sock );
+	}
+      catch ( SocketException& ) {}
+      catch ( std::exception& ) {}
+
+      {
+	std::lock_guard<std::mutex> lock ( m_mutex );
+	m_active.erase ( std::find ( m_active.begin(), m_active.end(), fd ) );
+      }
+    }
+}
@@ -0,0 +1,73 @@
+// Definition of the ThreadPoolServer class
+
+#ifndef ThreadPoolServer_class
+#define ThreadPoolServer_class
+
+#include "ServerSocket.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+const size_t MAXQUEUED = 1024;
+
+// What the acceptor does when every worker is busy and the queue is full.
+enum OverloadPolicy
+{
+  OVERLOAD_BLOCK,        // stop accepting until a slot frees up
+  OVERLOAD_REJECT,       // close the new connection
+  OVERLOAD_DROP_OLDEST   // close the longest-waiting queued connection
+};
+
+// Accepts on the calling thread and hands each connection to one of N
+// worker threads through a bounded queue. A handler owns its connection
+// until it returns; exceptions thrown from it close the connection.
+// stop() shuts down the connections being handled, so a handler blocked
+// in recv returns and the destructor can join the workers.
+class ThreadPoolServer
+{
+ public:
+
+  typedef std::function<void ( ServerSocket& )> Handler;
+
+  ThreadPoolServer ( ServerSocket& listener,
+		     Handler handler,
+		     size_t threads = 0,
+		     size_t queue_size = MAXQUEUED,
+		     OverloadPolicy policy = OVERLOAD_BLOCK );
+  virtual ~ThreadPoolServer();
+
+  void run();
+  void stop();
+
+  size_t threads() const { return m_workers.size(); }
+
+ private:
+
+  ThreadPoolServer ( const ThreadPoolServer& );
+  ThreadPoolServer& operator = ( const ThreadPoolServer& );
+
+  bool enqueue ( ServerSocket&& );
+  void work();
+
+  ServerSocket& m_listener;
+  Handler m_handler;
+  size_t m_queue_size;
+  OverloadPolicy m_policy;
+
+  std::mutex m_mutex;
+  std::condition_variable m_not_empty;
+  std::condition_variable m_not_full;
+  std::deque<ServerSocket> m_queue;
+  std::vector<int> m_active;   // connections being handled
+  bool m_running;
+
+  std::vector<std::thread> m_workers;
+
+};
+
+
+#endif
@@ -0,0 +1,210 @@
+// Implementation of the TimerWheel class
+
+#include "TimerWheel.h"
+#include <chrono>
+
+
+TimerWheel::Timer::Timer ( Callback c ) :
+  m_wheel ( 0 ),
+  m_expires ( 0 ),
+  m_callback ( c )
+{
+  m_prev = m_next = 0;
+}
+
+TimerWheel::Timer::~Timer()
+{
+  cancel();
+}
+
+
+void TimerWheel::Timer::cancel()
+{
+  if ( ! armed() )
+    return;
+
+  unlink ( *this );
+  m_wheel->m_count--;
+}
+
+
+TimerWheel::TimerWheel ( int tick_ms ) :
+  m_tick_ms ( tick_ms > 0 ? tick_ms : 1 ),
+  m_count ( 0 )
+{
+  for ( int l = 0; l < TIMER_LEVELS; l++ )
+    for ( int s = 0; s < TIMER_SLOTS; s++ )
+      m_slots[l][s].m_prev = m_slots[l][s].m_next = &m_slots[l][s];
+
+  m_current = now() / m_tick_ms + 1;
+}
+
+TimerWheel::~TimerWheel()
+{
+  // Leave any timers still armed in a state their destructors can handle.
+  for ( int l = 0; l < TIMER_LEVELS; l++ )
+    for ( int s = 0; s < TIMER_SLOTS; s++ )
+      while ( m_slots[l][s].m_next != &m_slots[l][s] )
+	unlink ( *m_slots[l][s].m_next );
+}
+
+
+uint64_t TimerWheel::now() const
+{
+  return std::chrono::duration_cast<std::chrono::milliseconds> (
+    std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+
+void TimerWheel::link ( Node& head, Node& n )
+{
+  n.m_prev = head.m_prev;
+  n.m_next = &head;
+  head.m_prev->m_next = &n;
+  head.m_prev = &n;
+}
+
+
+void TimerWheel::unlink ( Node& n )
+{
+  n.m_prev->m_next = n.m_next;
+  n.m_next->m_prev = n.m_prev;
+  n.m_prev = n.m_next = 0;
+}
+
+
+void TimerWheel::arm ( Timer& t, uint64_t delay_ms )
+{
+  t.cancel();
+
+  // m_current is the tick after the last one processed, so the deadline
+  // is never earlier than now + delay.
+  t.m_wheel = this;
+  t.m_expires = m_current + ( delay_ms + m_tick_ms - 1 ) / m_tick_ms;
+
+  insert ( t );
+  m_count++;
+}
+
+
+void TimerWheel::insert ( Timer& t )
+{
+  if ( t.m_expires < m_current )
+    {
+      link ( m_slots[0][m_current & ( TIMER_SLOTS - 1 )], t );
+      return;
+    }
+
+  uint64_t delta = t.m_expires - m_current;
+  uint64_t expires = t.m_expires;
+  int level = 0;
+
+  while ( level < TIMER_LEVELS && delta >> ( ( level + 1 ) * TIMER_SLOT_BITS ) )
+    level++;
+
+  // Too far out: park it in the furthest slot; each cascade re-files it.
+  if ( level == TIMER_LEVELS )
+    {
+      level = TIMER_LEVELS - 1;
+      expires = m_current + ( ( uint64_t ) 1 << ( TIMER_LEVELS * TIMER_SLOT_BITS ) ) - 1;
+    }
+
+  link ( m_slots[level][( expires >> ( level * TIMER_SLOT_BITS ) ) & ( TIMER_SLOTS - 1 )], t );
+}
+
+
+void TimerWheel::cascade ( int level )
+{
+  Node& head = m_slots[level][( m_current >> ( level * TIMER_SLOT_BITS ) ) & ( TIMER_SLOTS - 1 )];
+
+  while ( head.m_next != &head )
+    {
+      Timer& t = static_cast<Timer&> ( *head.m_next );
+      unlink ( t );
+      insert ( t );
+    }
+}
+
+
+size_t TimerWheel::expire()
+{
+  uint64_t target = now() / m_tick_ms;
+  size_t fired = 0;
+
+  while ( m_current <= target )
+    {
+      // Nothing armed: no need to step through the idle ticks.
+      if ( m_count == 0 )
+	{
+	  m_current = target + 1;
+	  break;
+	}
+
+      // Entering a new lap of a level pulls the matching slot of the
+      // level above down into finer slots.
+      for ( int l = 1; l < TIMER_LEVELS; l++ )
+	{
+	  if ( m_current & ( ( ( uint64_t ) 1 << ( l * TIMER_SLOT_BITS ) ) - 1 ) )
+	    break;
+	  cascade ( l );
+	}
+
+      // Detach the slot first, so callbacks can arm timers for this same
+      // tick without them running in this pass.
+      Node& head = m_slots[0][m_current & ( TIMER_SLOTS - 1 )];
+      Node due;
+      due.m_prev = due.m_next = &due;
+
+      if ( head.m_next != &head )
+	{
+	  due.m_next = head.m_next;
+	  due.m_prev = head.m_prev;
+	  due.m_next->m_prev = &due;
+	  due.m_prev->m_next = &due;
+	  head.m_prev = head.m_next = &head;
+	}
+
+      m_current++;
+
+      while ( due.m_next != &due )
+	{
+	  Timer& t = static_cast<Timer&> ( *due.m_next );
+	  unlink ( t );
+	  m_count--;
+	  fired++;
+
+	  // The callback may destroy the timer, so run it from a copy.
+	  Callback c = t.m_callback;
+	  if ( c )
+	    c();
+	}
+    }
+
+  return fired;
+}
+
+
+int TimerWheel::next_timeout() const
+{
+  if ( m_count == 0 )
+    return -1;
+
+  // The first occupied slot in the current lap of level 0, or the start
+  // of the next lap, where a cascade may bring timers down.
+  uint64_t tick = m_current;
+
+  for ( int i = 0; i < TIMER_SLOTS; i++, tick++ )
+    {
+      if ( ( tick & ( TIMER_SLOTS - 1 ) ) == 0 )
+	break;
+
+      const Node& head = m_slots[0][tick & ( TIMER_SLOTS - 1 )];
+      if ( head.m_next != &head )
+	break;
+    }
+
+  uint64_t at = tick * m_tick_ms;
+  uint64_t ms = now();
+
+  return at > ms ? ( int ) ( at - ms ) : 0;
+}
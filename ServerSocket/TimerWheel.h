@@ -0,0 +1,100 @@
+// Definition of the TimerWheel class
+
+#ifndef TimerWheel_class
+#define TimerWheel_class
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+
+
+const int TIMER_TICK_MS = 10;
+const int TIMER_LEVELS = 4;
+const int TIMER_SLOT_BITS = 6;
+const int TIMER_SLOTS = 1 << TIMER_SLOT_BITS;
+
+// A hierarchical timer wheel. Each level has 64 slots, and each slot is
+// 64 times coarser than the slot below it. A timer goes into the level
+// that its deadline falls in. When a lower level wraps around, the next
+// slot up is cascaded down. Arming and cancelling just relink a node, so
+// they are O(1) however many timers there are.
+// Deadlines are rounded up to whole ticks, so a timer never fires early.
+// Delays past the top level (about 46 hours at 10ms ticks) are capped.
+class TimerWheel
+{
+ private:
+
+  struct Node
+  {
+    Node* m_prev;
+    Node* m_next;
+  };
+
+ public:
+
+  typedef std::function<void ()> Callback;
+
+  // Owned by the caller, typically as a member of the object it guards.
+  // A timer is disarmed when it fires or is destroyed. Its callback may
+  // re-arm it, or destroy it along with its owner.
+  class Timer : private Node
+  {
+   public:
+
+    Timer ( Callback c = Callback() );
+    virtual ~Timer();
+
+    void set_callback ( Callback c ) { m_callback = c; }
+    bool armed() const { return m_next != 0; }
+    void cancel();
+
+   private:
+
+    friend class TimerWheel;
+
+    Timer ( const Timer& );
+    Timer& operator = ( const Timer& );
+
+    TimerWheel* m_wheel;
+    uint64_t m_expires;   // in ticks
+    Callback m_callback;
+
+  };
+
+  TimerWheel ( int tick_ms = TIMER_TICK_MS );
+  virtual ~TimerWheel();
+
+  // (Re)arms the timer to fire delay_ms from now.
+  void arm ( Timer&, uint64_t delay_ms );
+  void cancel ( Timer& t ) { t.cancel(); }
+
+  // Fires every timer that is due; returns how many fired.
+  size_t expire();
+
+  // Milliseconds until expire() next has work to do, or -1 if nothing
+  // is armed. Suitable as a poll timeout.
+  int next_timeout() const;
+
+  size_t size() const { return m_count; }
+
+ private:
+
+  TimerWheel ( const TimerWheel& );
+  TimerWheel& operator = ( const TimerWheel& );
+
+  uint64_t now() const;
+  void insert ( Timer& );
+  void cascade ( int level );
+
+  static void link ( Node& head, Node& n );
+  static void unlink ( Node& n );
+
+  int m_tick_ms;
+  uint64_t m_current;   // the next tick to process
+  size_t m_count;
+  Node m_slots [ TIMER_LEVELS ] [ TIMER_SLOTS ];
+
+};
+
+
+#endif
@@ -0,0 +1,607 @@
+// Implementation of the UringServer class
+
+#include "UringServer.h"
+#include "SocketException.h"
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <string.h>
+#include <errno.h>
+
+
+// Completion user_data: the connection id above the low byte, which holds
+// the operation.
+enum UringOp
+{
+  URING_ACCEPT = 1,
+  URING_RECV = 2,
+  URING_SEND = 3,
+  URING_PROVIDE = 4,
+  URING_CANCEL = 5,
+  URING_BACKOFF = 6
+};
+
+const unsigned short URING_BUFFER_GROUP = 0;
+
+
+UringServer::Connection::Connection ( UringServer& server, int fd, unsigned id ) :
+  m_server ( server ),
+  m_fd ( fd ),
+  m_id ( id ),
+  m_inflight ( 0 ),
+  m_receiving ( false ),
+  m_paused ( false ),
+  m_closing ( false ),
+  m_shutdown ( false )
+{
+}
+
+
+bool UringServer::Connection::send ( std::string_view s )
+{
+  if ( m_closing || s.empty() )
+    return ! m_paused;
+
+  if ( m_out.empty() )
+    m_server.m_dirty.push_back ( m_id );
+
+  m_out.append ( s );
+
+  // Backpressure: the receive armed now, if any, is the last until the
+  // output drains.
+  if ( queued() > m_server.m_high )
+    m_paused = true;
+
+  return ! m_paused;
+}
+
+
+void UringServer::Connection::close()
+{
+  if ( m_closing )
+    return;
+
+  m_closing = true;
+  m_server.m_dirty.push_back ( m_id );
+}
+
+
+UringServer::UringServer ( ServerSocket& listener, DataHandler handler ) :
+  m_listener ( listener ),
+  m_handler ( handler ),
+  m_buffers ( URING_BUFFERS * URING_BUFFER_SIZE ),
+  m_buf_ring ( ( io_uring_buf_ring* ) MAP_FAILED ),
+  m_buf_ring_size ( URING_BUFFERS * sizeof ( io_uring_buf ) ),
+  m_ring ( URING_ENTRIES ),
+  m_running ( false ),
+  m_low ( WRITE_LOW_WATERMARK ),
+  m_high ( WRITE_HIGH_WATERMARK ),
+  m_next_id ( 1 )
+{
+  // Prefer a provided buffer ring; where the kernel registers one but does
+  // not hand buffers out from it, use classic provided buffers instead.
+  if ( probe_buffer_ring() )
+    {
+      // The ring must be page aligned, which mmap guarantees.
+      m_buf_ring = ( io_uring_buf_ring* ) mmap ( 0, m_buf_ring_size, PROT_READ | PROT_WRITE,
+						 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+
+      if ( m_buf_ring == MAP_FAILED )
+	{
+	  throw SocketException ( "Could not allocate io_uring buffer ring." );
+	}
+
+      if ( ! m_ring.register_buffer_ring ( m_buf_ring, URING_BUFFERS, URING_BUFFER_GROUP ) )
+	{
+	  munmap ( m_buf_ring, m_buf_ring_size );
+	  throw SocketException ( "Could not register io_uring buffer ring." );
+	}
+
+      for ( unsigned i = 0; i < URING_BUFFERS; i++ )
+	recycle_buffer ( i );
+    }
+  else
+    {
+      io_uring_sqe* sqe = get_sqe();
+      sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+      sqe->fd = URING_BUFFERS;
+      sqe->addr = ( unsigned long ) &m_buffers[0];
+      sqe->len = URING_BUFFER_SIZE;
+      sqe->off = 0;
+      sqe->buf_group = URING_BUFFER_GROUP;
+      sqe->user_data = URING_PROVIDE;
+    }
+
+  arm_accept();
+}
+
+UringServer::~UringServer()
+{
+  cancel_all();
+  m_conns.clear();
+
+  if ( m_buf_ring != MAP_FAILED )
+    munmap ( m_buf_ring, m_buf_ring_size );
+}
+
+
+void UringServer::cancel_all()
+{
+  // Receives and sends still in flight point into connection memory, so
+  // every request is cancelled and each connection's are waited for
+  // before any of it is freed. Shutting the sockets down completes any
+  // that are past cancelling.
+  for ( auto& c : m_conns )
+    ::shutdown ( c.second->m_fd, SHUT_RDWR );
+
+  io_uring_sqe* sqe = m_ring.get_sqe();
+
+  if ( sqe )
+    {
+      sqe->opcode = IORING_OP_ASYNC_CANCEL;
+      sqe->cancel_flags = IORING_ASYNC_CANCEL_ALL | IORING_ASYNC_CANCEL_ANY;
+      sqe->user_data = URING_CANCEL;
+    }
+
+  while ( true )
+    {
+      unsigned pending = 0;
+
+      for ( auto& c : m_conns )
+	pending += c.second->m_inflight;
+
+      if ( pending == 0 )
+	break;
+
+      if ( m_ring.submit ( 1 ) == -1 && errno != EINTR && errno != EBUSY )
+	break;
+
+      io_uring_cqe* cqe;
+
+      while ( ( cqe = m_ring.peek_cqe() ) != 0 )
+	{
+	  io_uring_cqe c = *cqe;
+	  m_ring.cqe_seen();
+
+	  unsigned op = c.user_data & 0xff;
+
+	  // Accepted while shutting down: not wanted.
+	  if ( op == URING_ACCEPT && c.res >= 0 )
+	    ::close ( c.res );
+
+	  if ( op != URING_RECV && op != URING_SEND )
+	    continue;
+
+	  auto it = m_conns.find ( c.user_data >> 8 );
+	  if ( it != m_conns.end() )
+	    it->second->m_inflight--;
+	}
+    }
+}
+
+
+bool UringServer::available()
+{
+  try
+    {
+      IoUring ring ( 8 );
+
+      void* buf_ring = mmap ( 0, 4096, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+      if ( buf_ring == MAP_FAILED )
+	return false;
+
+      bool ok = ring.register_buffer_ring ( buf_ring, 8, URING_BUFFER_GROUP );
+      munmap ( buf_ring, 4096 );
+
+      return ok && probe_multishot_accept ( ring );
+    }
+  catch ( SocketException& )
+    {
+      return false;
+    }
+}
+
+
+// A kernel, or a backport, can have buffer rings without multishot
+// accept, which it refuses with EINVAL. Accepts one loopback connection.
+bool UringServer::probe_multishot_accept ( IoUring& ring )
+{
+  int listener = ::socket ( AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+  int client = ::socket ( AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+  bool ok = false;
+
+  sockaddr_in addr = sockaddr_in();
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl ( INADDR_LOOPBACK );
+  socklen_t len = sizeof ( addr );
+
+  if ( listener != -1 && client != -1 &&
+       ::bind ( listener, ( sockaddr* ) &addr, sizeof ( addr ) ) == 0 &&
+       ::listen ( listener, 1 ) == 0 &&
+       ::getsockname ( listener, ( sockaddr* ) &addr, &len ) == 0 &&
+       ::connect ( client, ( sockaddr* ) &addr, sizeof ( addr ) ) == 0 )
+    {
+      io_uring_sqe* sqe = ring.get_sqe();
+      sqe->opcode = IORING_OP_ACCEPT;
+      sqe->fd = listener;
+      sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+      sqe->accept_flags = SOCK_CLOEXEC;
+
+      if ( ring.submit ( 1 ) == 1 )
+	{
+	  io_uring_cqe* cqe = ring.peek_cqe();
+
+	  if ( cqe != 0 )
+	    {
+	      ok = cqe->res >= 0;
+	      if ( ok )
+		::close ( cqe->res );
+	      ring.cqe_seen();
+	    }
+	}
+    }
+
+  // The accept still armed on the listener is cancelled with the ring.
+  if ( client != -1 )
+    ::close ( client );
+  if ( listener != -1 )
+    ::close ( listener );
+
+  return ok;
+}
+
+
+bool UringServer::probe_buffer_ring()
+{
+  IoUring ring ( 8 );
+
+  void* mem = mmap ( 0, 4096, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+  if ( mem == MAP_FAILED )
+    return false;
+
+  io_uring_buf_ring* br = ( io_uring_buf_ring* ) mem;
+  char byte;
+  int sv[2] = { -1, -1 };
+  bool ok = false;
+
+  if ( ring.register_buffer_ring ( br, 8, URING_BUFFER_GROUP ) &&
+       socketpair ( AF_UNIX, SOCK_STREAM, 0, sv ) == 0 &&
+       ::write ( sv[1], "x", 1 ) == 1 )
+    {
+      br->bufs[0].addr = ( unsigned long ) &byte;
+      br->bufs[0].len = 1;
+      br->bufs[0].bid = 0;
+      __atomic_store_n ( &br->tail, ( unsigned short ) 1, __ATOMIC_RELEASE );
+
+      io_uring_sqe* sqe = ring.get_sqe();
+      sqe->opcode = IORING_OP_RECV;
+      sqe->fd = sv[0];
+      sqe->flags = IOSQE_BUFFER_SELECT;
+      sqe->buf_group = URING_BUFFER_GROUP;
+
+      if ( ring.submit ( 1 ) == 1 )
+	{
+	  io_uring_cqe* cqe = ring.peek_cqe();
+	  ok = cqe != 0 && cqe->res == 1;
+	}
+    }
+
+  if ( sv[0] != -1 )
+    {
+      ::close ( sv[0] );
+      ::close ( sv[1] );
+    }
+
+  munmap ( mem, 4096 );
+
+  return ok;
+}
+
+
+void UringServer::run()
+{
+  m_running = true;
+
+  while ( m_running )
+    {
+      if ( m_ring.submit ( 1 ) == -1 && errno != EINTR && errno != EBUSY )
+	{
+	  throw SocketException ( "Could not submit to io_uring." );
+	}
+
+      io_uring_cqe* cqe;
+
+      while ( ( cqe = m_ring.peek_cqe() ) != 0 )
+	{
+	  io_uring_cqe c = *cqe;
+	  m_ring.cqe_seen();
+
+	  unsigned op = c.user_data & 0xff;
+	  unsigned id = c.user_data >> 8;
+
+	  if ( op == URING_ACCEPT )
+	    {
+	      on_accept ( c );
+	      continue;
+	    }
+
+	  if ( op == URING_BACKOFF )
+	    {
+	      arm_accept();
+	      continue;
+	    }
+
+	  if ( op == URING_PROVIDE )
+	    {
+	      if ( c.res < 0 )
+		{
+		  throw SocketException ( "Could not provide io_uring buffers." );
+		}
+	      continue;
+	    }
+
+	  auto it = m_conns.find ( id );
+	  if ( it == m_conns.end() )
+	    continue;
+
+	  Connection& conn = *it->second;
+	  conn.m_inflight--;
+
+	  if ( op == URING_RECV )
+	    on_recv ( conn, c );
+	  else
+	    on_send ( conn, c );
+
+	  finish ( conn );
+	}
+
+      // Sends queued while handling this batch are submitted with the next
+      // io_uring_enter, together with the re-armed receives.
+      m_flushing.swap ( m_dirty );
+
+      for ( size_t i = 0; i < m_flushing.size(); i++ )
+	{
+	  auto it = m_conns.find ( m_flushing[i] );
+	  if ( it == m_conns.end() )
+	    continue;
+
+	  arm_send ( *it->second );
+	  finish ( *it->second );
+	}
+
+      m_flushing.clear();
+    }
+}
+
+
+io_uring_sqe* UringServer::get_sqe()
+{
+  io_uring_sqe* sqe = m_ring.get_sqe();
+
+  if ( sqe == 0 )
+    {
+      throw SocketException ( "io_uring submission queue is full." );
+    }
+
+  return sqe;
+}
+
+
+void UringServer::arm_accept()
+{
+  io_uring_sqe* sqe = get_sqe();
+  sqe->opcode = IORING_OP_ACCEPT;
+  sqe->fd = m_listener.fd();
+  sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+  sqe->accept_flags = SOCK_CLOEXEC;
+  sqe->user_data = URING_ACCEPT;
+}
+
+
+void UringServer::arm_backoff()
+{
+  m_backoff.tv_sec = ACCEPT_BACKOFF_MS / 1000;
+  m_backoff.tv_nsec = ( ACCEPT_BACKOFF_MS % 1000 ) * 1000000L;
+
+  io_uring_sqe* sqe = get_sqe();
+  sqe->opcode = IORING_OP_TIMEOUT;
+  sqe->fd = -1;
+  sqe->addr = ( unsigned long ) &m_backoff;
+  sqe->len = 1;
+  sqe->user_data = URING_BACKOFF;
+}
+
+
+void UringServer::arm_recv ( Connection& c )
+{
+  if ( c.m_receiving )
+    return;
+
+  io_uring_sqe* sqe = get_sqe();
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = c.m_fd;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = URING_BUFFER_GROUP;
+  sqe->user_data = ( ( unsigned long long ) c.m_id << 8 ) | URING_RECV;
+
+  c.m_inflight++;
+  c.m_receiving = true;
+}
+
+
+void UringServer::arm_send ( Connection& c )
+{
+  // One send in flight per connection keeps the byte stream in order.
+  if ( ! c.m_sending.empty() )
+    return;
+
+  if ( c.m_out.empty() )
+    return;
+
+  c.m_sending.swap ( c.m_out );
+
+  io_uring_sqe* sqe = get_sqe();
+  sqe->opcode = IORING_OP_SEND;
+  sqe->fd = c.m_fd;
+  sqe->addr = ( unsigned long ) c.m_sending.data();
+  sqe->len = c.m_sending.size();
+  sqe->msg_flags = MSG_NOSIGNAL;
+  sqe->user_data = ( ( unsigned long long ) c.m_id << 8 ) | URING_SEND;
+
+  c.m_inflight++;
+}
+
+
+void UringServer::recycle_buffer ( unsigned short bid )
+{
+  char* addr = &m_buffers[( size_t ) bid * URING_BUFFER_SIZE];
+
+  if ( m_buf_ring == MAP_FAILED )
+    {
+      // Classic provided buffers take a submission each; it rides along
+      // with the batch and posts no completion unless it fails.
+      io_uring_sqe* sqe = get_sqe();
+      sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+      sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+      sqe->fd = 1;
+      sqe->addr = ( unsigned long ) addr;
+      sqe->len = URING_BUFFER_SIZE;
+      sqe->off = bid;
+      sqe->buf_group = URING_BUFFER_GROUP;
+      sqe->user_data = URING_PROVIDE;
+      return;
+    }
+
+  unsigned short tail = m_buf_ring->tail;
+  io_uring_buf& buf = m_buf_ring->bufs[tail & ( URING_BUFFERS - 1 )];
+
+  buf.addr = ( unsigned long ) addr;
+  buf.len = URING_BUFFER_SIZE;
+  buf.bid = bid;
+
+  __atomic_store_n ( &m_buf_ring->tail, ( unsigned short ) ( tail + 1 ), __ATOMIC_RELEASE );
+}
+
+
+void UringServer::on_accept ( const io_uring_cqe& cqe )
+{
+  // Without IORING_CQE_F_MORE the multishot accept has ended and must be
+  // armed again.
+  if ( ! ( cqe.flags & IORING_CQE_F_MORE ) )
+    {
+      if ( cqe.res == -EINVAL )
+	{
+	  throw SocketException ( "io_uring multishot accept is not supported." );
+	}
+
+      // Out of descriptors or memory: re-arming at once would only fail
+      // again, so wait ACCEPT_BACKOFF_MS and leave the backlog queued.
+      if ( cqe.res < 0 && ! accept_retry_now ( -cqe.res ) )
+	arm_backoff();
+      else
+	arm_accept();
+    }
+
+  if ( cqe.res < 0 )
+    return;
+
+  // Ids are 24 bits in user_data; once they wrap, skip any still in use
+  // so a completion can never reach the wrong connection.
+  unsigned id;
+
+  do
+    {
+      id = m_next_id++;
+      if ( m_next_id >= ( 1u << 24 ) )
+	m_next_id = 1;
+    }
+  while ( m_conns.count ( id ) );
+
+  Connection* c = new Connection ( *this, cqe.res, id );
+  m_conns[id].reset ( c );
+
+  arm_recv ( *c );
+}
+
+
+void UringServer::on_recv ( Connection& c, const io_uring_cqe& cqe )
+{
+  c.m_receiving = false;
+
+  if ( cqe.res == -ENOBUFS )
+    {
+      // Every buffer is in use; they come back as this batch is handled.
+      if ( ! c.m_closing && ! c.m_paused )
+	arm_recv ( c );
+      return;
+    }
+
+  if ( cqe.res <= 0 )
+    {
+      c.m_closing = true;
+      return;
+    }
+
+  unsigned short bid = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+
+  if ( ! c.m_closing )
+    m_handler ( c, std::string_view ( &m_buffers[( size_t ) bid * URING_BUFFER_SIZE], cqe.res ) );
+
+  recycle_buffer ( bid );
+
+  if ( ! c.m_closing && ! c.m_paused )
+    arm_recv ( c );
+}
+
+
+void UringServer::on_send ( Connection& c, const io_uring_cqe& cqe )
+{
+  if ( cqe.res < 0 )
+    {
+      c.m_sending.clear();
+      c.m_out.clear();
+      c.m_closing = true;
+      return;
+    }
+
+  c.m_sending.erase ( 0, cqe.res );
+
+  if ( ! c.m_sending.empty() )
+    {
+      // Partial write: resubmit the rest ahead of anything queued since.
+      c.m_out.insert ( 0, c.m_sending );
+      c.m_sending.clear();
+    }
+
+  arm_send ( c );
+
+  if ( c.m_paused && c.queued() < m_low )
+    {
+      c.m_paused = false;
+      if ( ! c.m_closing )
+	arm_recv ( c );
+    }
+}
+
+
+void UringServer::finish ( Connection& c )
+{
+  if ( ! c.m_closing )
+    return;
+
+  // Let queued output drain before tearing the connection down.
+  if ( ! c.m_out.empty() || ! c.m_sending.empty() )
+    return;
+
+  if ( c.m_inflight == 0 )
+    {
+      m_conns.erase ( c.m_id );
+      return;
+    }
+
+  // Completes the pending receive, after which the connection is freed.
+  if ( ! c.m_shutdown )
+    {
+      ::shutdown ( c.m_fd, SHUT_RDWR );
+      c.m_shutdown = true;
+    }
+}
@@ -0,0 +1,127 @@
+// Definition of the UringServer class
+
+#ifndef UringServer_class
+#define UringServer_class
+
+#include "ServerSocket.h"
+#include "IoUring.h"
+#include "WriteQueue.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+
+const unsigned URING_ENTRIES = 4096;
+const unsigned URING_BUFFERS = 1024;
+const unsigned URING_BUFFER_SIZE = 4096;
+
+// The io_uring counterpart of ReactorServer, with the same handler
+// interface. One multishot accept feeds new connections; receives pick
+// their memory from a provided buffer ring (or classic provided buffers
+// where the ring is not usable), and all accept, recv and send
+// submissions of a batch go to the kernel in a single io_uring_enter.
+// As with ReactorServer, a connection whose queued output passes the
+// high watermark is not read from until it drains below the low one.
+class UringServer
+{
+ public:
+
+  class Connection
+  {
+   public:
+
+    ~Connection() { ::close ( m_fd ); }
+
+    // Returns false while the queued output is above the high watermark.
+    bool send ( std::string_view );
+    void close();
+
+    size_t queued() const { return m_out.size() + m_sending.size(); }
+
+    int fd() const { return m_fd; }
+
+   private:
+
+    friend class UringServer;
+
+    Connection ( UringServer& server, int fd, unsigned id );
+
+    UringServer& m_server;
+    int m_fd;
+    unsigned m_id;
+    std::string m_out;       // queued by send()
+    std::string m_sending;   // owned by the kernel until its send completes
+    unsigned m_inflight;
+    bool m_receiving;
+    bool m_paused;     // above the high watermark, so not receiving
+    bool m_closing;
+    bool m_shutdown;
+
+  };
+
+  typedef std::function<void ( Connection&, std::string_view )> DataHandler;
+
+  UringServer ( ServerSocket& listener, DataHandler handler );
+  virtual ~UringServer();
+
+  void run();
+  void stop() { m_running = false; }
+
+  // Applies to every connection from the next send on.
+  void set_watermarks ( size_t low, size_t high ) { m_low = low; m_high = high; }
+
+  size_t connections() const { return m_conns.size(); }
+
+  // Whether this kernel offers everything the server needs (provided
+  // buffer rings and multishot accept, Linux 5.19 and later).
+  static bool available();
+
+ private:
+
+  UringServer ( const UringServer& );
+  UringServer& operator = ( const UringServer& );
+
+  static bool probe_buffer_ring();
+  static bool probe_multishot_accept ( IoUring& );
+
+  io_uring_sqe* get_sqe();
+  void arm_accept();
+  void arm_backoff();
+  void arm_recv ( Connection& );
+  void arm_send ( Connection& );
+  void recycle_buffer ( unsigned short bid );
+
+  void on_accept ( const io_uring_cqe& );
+  void on_recv ( Connection&, const io_uring_cqe& );
+  void on_send ( Connection&, const io_uring_cqe& );
+  void finish ( Connection& );
+  void cancel_all();
+
+  ServerSocket& m_listener;
+  DataHandler m_handler;
+
+  // Declared ahead of the ring so the kernel is done with them before
+  // they are freed.
+  std::vector<char> m_buffers;
+  io_uring_buf_ring* m_buf_ring;
+  size_t m_buf_ring_size;
+
+  IoUring m_ring;
+  bool m_running;
+  size_t m_low;
+  size_t m_high;
+
+  __kernel_timespec m_backoff;   // the accept backoff timeout
+
+  std::unordered_map<unsigned, std::unique_ptr<Connection> > m_conns;
+  unsigned m_next_id;
+  std::vector<unsigned> m_dirty;   // connections with output queued this batch
+  std::vector<unsigned> m_flushing;
+
+};
+
+
+#endif
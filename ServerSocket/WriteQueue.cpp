@@ -0,0 +1,194 @@
+// Implementation of the WriteQueue class
+
+#include "WriteQueue.h"
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+
+
+const size_t WRITE_IOV = 64;
+
+
+WriteQueue::WriteQueue ( BufferPool& pool, size_t low, size_t high ) :
+  m_pool ( pool ),
+  m_ring ( m_inline ),
+  m_capacity ( WRITE_INLINE ),
+  m_head ( 0 ),
+  m_count ( 0 ),
+  m_offset ( 0 ),
+  m_size ( 0 ),
+  m_low ( low ),
+  m_high ( high ),
+  m_above_high ( false )
+{
+}
+
+WriteQueue::~WriteQueue()
+{
+  clear();
+
+  if ( m_ring != m_inline )
+    delete [] m_ring;
+}
+
+
+void WriteQueue::push_chunk ( const Chunk& c )
+{
+  if ( m_count == m_capacity )
+    {
+      Chunk* ring = new Chunk [ 2 * m_capacity ];
+
+      for ( size_t i = 0; i < m_count; i++ )
+	ring[i] = chunk ( i );
+
+      if ( m_ring != m_inline )
+	delete [] m_ring;
+
+      m_ring = ring;
+      m_capacity *= 2;
+      m_head = 0;
+    }
+
+  chunk ( m_count++ ) = c;
+}
+
+
+void WriteQueue::pop_chunk()
+{
+  m_head = ( m_head + 1 ) & ( m_capacity - 1 );
+  m_count--;
+}
+
+
+void WriteQueue::release ( Chunk& c )
+{
+  if ( c.shared )
+    c.shared->unref();
+  else
+    m_pool.release ( c.data );
+}
+
+
+void WriteQueue::clear()
+{
+  while ( m_count > 0 )
+    {
+      release ( chunk ( 0 ) );
+      pop_chunk();
+    }
+
+  m_offset = 0;
+  m_size = 0;
+  m_above_high = false;
+}
+
+
+void WriteQueue::set_watermarks ( size_t low, size_t high )
+{
+  m_low = low;
+  m_high = high;
+}
+
+
+bool WriteQueue::push ( std::string_view s )
+{
+  if ( s.empty() )
+    return ! m_above_high;
+
+  // Small writes are packed into the last chunk rather than each taking
+  // an iovec of their own; big ones fill as many chunks as they need.
+  while ( ! s.empty() )
+    {
+      if ( m_count == 0 || chunk ( m_count - 1 ).shared || chunk ( m_count - 1 ).size == WRITE_CHUNK )
+	{
+	  Chunk c = { m_pool.acquire(), 0, 0 };
+	  push_chunk ( c );
+	}
+
+      Chunk& c = chunk ( m_count - 1 );
+      size_t n = std::min ( s.size(), WRITE_CHUNK - c.size );
+
+      memcpy ( c.data + c.size, s.data(), n );
+      c.size += n;
+      m_size += n;
+      s.remove_prefix ( n );
+    }
+
+  return check_high();
+}
+
+
+bool WriteQueue::push ( SharedBuffer* b )
+{
+  if ( b->size() == 0 )
+    return ! m_above_high;
+
+  b->ref();
+
+  Chunk c = { const_cast<char*> ( b->data() ), b->size(), b };
+  push_chunk ( c );
+  m_size += b->size();
+
+  return check_high();
+}
+
+
+bool WriteQueue::check_high()
+{
+  if ( ! m_above_high && m_size > m_high )
+    {
+      m_above_high = true;
+      if ( m_on_high )
+	m_on_high();
+    }
+
+  return ! m_above_high;
+}
+
+
+bool WriteQueue::flush ( const ServerSocket& sock )
+{
+  while ( m_size > 0 )
+    {
+      iovec iov [ WRITE_IOV ];
+      size_t count = 0;
+
+      for ( ; count < m_count && count < WRITE_IOV; count++ )
+	{
+	  Chunk& c = chunk ( count );
+	  size_t skip = count == 0 ? m_offset : 0;
+	  iov[count].iov_base = c.data + skip;
+	  iov[count].iov_len = c.size - skip;
+	}
+
+      ssize_t n = sock.write_some ( std::span<const iovec> ( iov, count ) );
+
+      if ( n == -1 )
+	{
+	  if ( errno != EAGAIN && errno != EWOULDBLOCK )
+	    return false;
+	  break;
+	}
+
+      m_size -= n;
+      n += m_offset;
+
+      while ( m_count > 0 && ( size_t ) n >= chunk ( 0 ).size )
+	{
+	  n -= chunk ( 0 ).size;
+	  release ( chunk ( 0 ) );
+	  pop_chunk();
+	}
+
+      m_offset = n;
+    }
+
+  if ( m_above_high && m_size < m_low )
+    {
+      m_above_high = false;
+      if ( m_on_low )
+	m_on_low();
+    }
+
+  return true;
+}
@@ -0,0 +1,95 @@
+// Definition of the WriteQueue class
+
+#ifndef WriteQueue_class
+#define WriteQueue_class
+
+#include "ServerSocket.h"
+#include "BufferPool.h"
+#include "SharedBuffer.h"
+#include <functional>
+#include <string>
+#include <string_view>
+
+
+const size_t WRITE_LOW_WATERMARK = 64 * 1024;
+const size_t WRITE_HIGH_WATERMARK = 1024 * 1024;
+const size_t WRITE_CHUNK = 16 * 1024;
+const size_t WRITE_INLINE = 16;
+
+// Outbound bytes for one non-blocking connection. Whatever the kernel does
+// not take is kept and written with later flushes, several chunks per
+// sendmsg. Crossing the high watermark tells the producer to pause;
+// draining below the low watermark tells it to resume. Chunks of
+// WRITE_CHUNK bytes come from a BufferPool, shared by every queue on the
+// same loop. A SharedBuffer is queued by reference rather than copied.
+// The chunk list is a ring of WRITE_INLINE entries held in the queue
+// itself; only a deeper queue moves it to the heap, where it stays.
+class WriteQueue
+{
+ public:
+
+  typedef std::function<void ()> Callback;
+
+  WriteQueue ( BufferPool&, size_t low = WRITE_LOW_WATERMARK, size_t high = WRITE_HIGH_WATERMARK );
+  virtual ~WriteQueue();
+
+  void set_watermarks ( size_t low, size_t high );
+  void on_high_watermark ( Callback c ) { m_on_high = c; }
+  void on_low_watermark ( Callback c ) { m_on_low = c; }
+
+  // Queues the bytes; returns false while the queue is above the high
+  // watermark. Nothing is ever dropped.
+  bool push ( std::string_view );
+
+  // Queues a reference to the buffer, released once it is written.
+  bool push ( SharedBuffer* );
+
+  // Writes until the queue is empty or the socket would block. Returns
+  // false on a socket error.
+  bool flush ( const ServerSocket& );
+
+  // Drops everything queued, unwritten, without calling either watermark
+  // callback.
+  void clear();
+
+  size_t size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+  bool above_high_watermark() const { return m_above_high; }
+
+ private:
+
+  WriteQueue ( const WriteQueue& );
+  WriteQueue& operator = ( const WriteQueue& );
+
+  struct Chunk
+  {
+    char* data;
+    size_t size;
+    SharedBuffer* shared;   // owner of data, or 0 for a pool buffer
+  };
+
+  Chunk& chunk ( size_t i ) { return m_ring[( m_head + i ) & ( m_capacity - 1 )]; }
+  void push_chunk ( const Chunk& );
+  void pop_chunk();
+  void release ( Chunk& );
+  bool check_high();
+
+  BufferPool& m_pool;
+  Chunk m_inline [ WRITE_INLINE ];
+  Chunk* m_ring;       // m_inline, or a bigger heap copy
+  size_t m_capacity;   // a power of two
+  size_t m_head;
+  size_t m_count;
+  size_t m_offset;   // bytes of the front chunk already written
+  size_t m_size;
+
+  size_t m_low;
+  size_t m_high;
+  bool m_above_high;
+  Callback m_on_high;
+  Callback m_on_low;
+
+};
+
+
+#endif
@@ -0,0 +1,209 @@
+// Load generator for the echo servers: many concurrent ClientSocket
+// connections, fixed-size messages, optional pipelining, closed loop or a
+// fixed open-loop rate. Reports throughput and latency percentiles.
+
+#include "ClientSocket.h"
+#include "EventLoop.h"
+#include "LatencyHistogram.h"
+#include "SocketException.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+struct Options {
+  std::string host = "127.0.0.1";
+  int port = 30000;
+  int connections = 16;
+  int threads = 1;
+  size_t size = 64;
+  int depth = 1;        // messages in flight per connection (closed loop)
+  double rate = 0;      // messages per second over all connections; 0 = closed loop
+  double seconds = 5;
+  bool framed = false;  // 4-byte length prefix, as Socket::send_message
+};
+
+struct Conn {
+  std::unique_ptr<ClientSocket> sock;
+  std::deque<Clock::time_point> sent;  // send time of each message in flight
+  std::string out;                     // bytes the kernel has not taken yet
+  size_t received = 0;                 // bytes of the current reply
+};
+
+struct Result {
+  LatencyHistogram latency;
+  uint64_t messages = 0;
+  uint64_t errors = 0;
+};
+
+static void usage() {
+  std::cout << "usage: bench_client [-c connections] [-t threads] [-s size] "
+               "[-d depth] [-r rate] [-T seconds] [-f] [host|path] [port]\n";
+}
+
+static void run_thread(const Options& opt, int nconns, double rate,
+                       Result& total, std::mutex& total_mutex) {
+  Result r;
+  std::string message(opt.size, 'x');
+  if (opt.framed) {
+    uint32_t len = htonl(opt.size);
+    message.insert(0, (const char*)&len, sizeof(len));
+  }
+  std::vector<char> buf(64 * 1024);
+  std::vector<Conn> conns(nconns);
+  EventLoop loop;
+
+  auto flush = [&](Conn& c) {
+    while (!c.out.empty()) {
+      ssize_t n = c.sock->write_some(c.out.data(), c.out.size());
+      if (n == -1) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) r.errors++;
+        break;
+      }
+      c.out.erase(0, n);
+    }
+    loop.set_write_interest(c.sock->fd(), !c.out.empty());
+  };
+
+  auto send = [&](Conn& c, Clock::time_point when) {
+    c.sent.push_back(when);
+    c.out.append(message);
+    if (c.out.size() == message.size()) flush(c);
+  };
+
+  try {
+    for (size_t i = 0; i < conns.size(); i++) {
+      Conn& c = conns[i];
+      if (opt.host[0] == '/' || opt.host[0] == '@')
+        c.sock.reset(new ClientSocket(opt.host));
+      else
+        c.sock.reset(new ClientSocket(opt.host, opt.port));
+      c.sock->set_non_blocking(true);
+
+      loop.add(c.sock->fd(), [&, i]() {
+        Conn& c = conns[i];
+        while (true) {
+          ssize_t n = c.sock->read_some(&buf[0], buf.size());
+          if (n == 0 || (n == -1 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+            r.errors++;
+            loop.remove(c.sock->fd());
+            return;
+          }
+          if (n == -1) return;
+
+          c.received += n;
+          while (c.received >= message.size() && !c.sent.empty()) {
+            c.received -= message.size();
+            Clock::time_point now = Clock::now();
+            r.latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                now - c.sent.front()).count());
+            c.sent.pop_front();
+            r.messages++;
+            if (rate == 0) send(c, now);
+          }
+        }
+      }, [&, i]() { flush(conns[i]); });
+    }
+  }
+  catch (SocketException& e) {
+    std::cout << "Exception was caught:" << e.description() << "\n";
+    return;
+  }
+
+  Clock::time_point start = Clock::now();
+  Clock::time_point end = start + std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(opt.seconds));
+
+  if (rate == 0) {
+    for (size_t i = 0; i < conns.size(); i++)
+      for (int d = 0; d < opt.depth; d++) send(conns[i], start);
+  }
+
+  // Open loop: messages are due at fixed intervals and timed from when
+  // they were due, so a stalled server cannot hide its queueing delay.
+  Clock::duration interval = rate > 0
+      ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate))
+      : Clock::duration::zero();
+  Clock::time_point next = start;
+  size_t rr = 0;
+
+  while (true) {
+    Clock::time_point now = Clock::now();
+    if (now >= end) break;
+
+    int timeout = 1;
+    if (rate > 0) {
+      while (next <= now) {
+        send(conns[rr++ % conns.size()], next);
+        next += interval;
+      }
+      timeout = std::chrono::duration_cast<std::chrono::milliseconds>(next - now).count();
+    }
+    loop.run_once(timeout);
+  }
+
+  std::lock_guard<std::mutex> lock(total_mutex);
+  total.latency.merge(r.latency);
+  total.messages += r.messages;
+  total.errors += r.errors;
+}
+
+int main(int argc, char *argv[]) {
+  Options opt;
+  int ch;
+  while ((ch = getopt(argc, argv, "c:t:s:d:r:T:fh")) != -1) {
+    switch (ch) {
+      case 'c': opt.connections = std::atoi(optarg); break;
+      case 't': opt.threads = std::atoi(optarg); break;
+      case 's': opt.size = std::atoi(optarg); break;
+      case 'd': opt.depth = std::atoi(optarg); break;
+      case 'r': opt.rate = std::atof(optarg); break;
+      case 'T': opt.seconds = std::atof(optarg); break;
+      case 'f': opt.framed = true; break;
+      default: usage(); return 1;
+    }
+  }
+  if (optind < argc) opt.host = argv[optind++];
+  if (optind < argc) opt.port = std::atoi(argv[optind++]);
+
+  if (opt.threads < 1) opt.threads = 1;
+  if (opt.connections < opt.threads) opt.connections = opt.threads;
+  if (opt.size < 1) opt.size = 1;
+  if (opt.depth < 1) opt.depth = 1;
+
+  Result total;
+  std::mutex total_mutex;
+  std::vector<std::thread> threads;
+
+  for (int t = 0; t < opt.threads; t++) {
+    int nconns = opt.connections / opt.threads + (t < opt.connections % opt.threads);
+    threads.push_back(std::thread(run_thread, std::cref(opt), nconns,
+                                  opt.rate / opt.threads, std::ref(total),
+                                  std::ref(total_mutex)));
+  }
+  for (size_t i = 0; i < threads.size(); i++) threads[i].join();
+
+  double msgs = total.messages / opt.seconds;
+  std::cout << opt.connections << " connections, " << opt.size << " byte messages, "
+            << (opt.rate > 0 ? "open loop" : "closed loop, depth ")
+            << (opt.rate > 0 ? "" : std::to_string(opt.depth)) << "\n"
+            << "throughput: " << (uint64_t) msgs << " msg/s, "
+            << msgs * opt.size * 2 / 1e6 << " MB/s (both directions)\n"
+            << "latency us: p50 " << total.latency.percentile(0.50) / 1e3
+            << "  p99 " << total.latency.percentile(0.99) / 1e3
+            << "  p99.9 " << total.latency.percentile(0.999) / 1e3
+            << "  max " << total.latency.max() / 1e3 << "\n";
+  if (total.errors)
+    std::cout << "errors: " << total.errors << "\n";
+  return 0;
+}
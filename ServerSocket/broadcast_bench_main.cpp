@@ -0,0 +1,116 @@
+// Fans messages out to many subscribers through BroadcastServer, once
+// with each message in one shared, refcounted buffer and once copied into
+// every subscriber's queue, and measures the server thread's CPU time.
+
+#include "BroadcastServer.h"
+#include "ClientSocket.h"
+#include "EventLoop.h"
+#include "ServerSocket.h"
+#include "SocketException.h"
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+const size_t BATCH = 50;
+
+static double thread_cpu() {
+  rusage ru;
+  getrusage(RUSAGE_THREAD, &ru);
+  return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec +
+         (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+int main(int argc, const char *argv[]) {
+  // usage: broadcast_bench [port] [subscribers] [messages] [bytes]
+  int port = argc > 1 ? std::atoi(argv[1]) : 30090;
+  size_t subscribers = argc > 2 ? std::atoi(argv[2]) : 1000;
+  size_t messages = argc > 3 ? std::atoi(argv[3]) : 1000;
+  size_t bytes = argc > 4 ? std::atoi(argv[4]) : 1024;
+  messages -= messages % BATCH;
+  if (messages == 0) messages = BATCH;
+
+  std::string pub = "PUB ticks " + std::string(bytes, 'x') + "\n";
+  std::string batch;
+  for (size_t i = 0; i < BATCH; i++) batch += pub;
+  size_t line = pub.size() - 4;  // "ticks xxx...\n"
+
+  const char* names[] = { "shared", "copied" };
+
+  try {
+    for (int mode = 0; mode < 2; mode++) {
+      ServerSocket listener(port, false, SOMAXCONN);
+      BroadcastServer server(listener);
+      server.set_shared(mode == 0);
+
+      int wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+      server.reactor().loop().add(wake, [&] { server.stop(); });
+
+      // Subscribers are read from one loop, counting bytes as they come.
+      EventLoop loop;
+      std::vector<ClientSocket> subs;
+      std::vector<char> buf(256 * 1024);
+      size_t received = 0;
+
+      for (size_t i = 0; i < subscribers; i++) {
+        subs.push_back(ClientSocket("127.0.0.1", port));
+        subs.back() << std::string("SUB ticks\n");
+        subs.back().set_non_blocking(true);
+      }
+      for (size_t i = 0; i < subscribers; i++) {
+        const ClientSocket* s = &subs[i];
+        loop.add(s->fd(), [&, s] {
+          ssize_t n;
+          while ((n = s->read_some(&buf[0], buf.size())) > 0) received += n;
+        });
+      }
+
+      // Every SUB is taken in here, before the server gets its thread.
+      while (server.subscribers("ticks") < subscribers)
+        server.reactor().loop().run_once(100);
+
+      double cpu = 0;
+      std::thread server_thread([&] {
+        double start = thread_cpu();
+        server.run();
+        cpu = thread_cpu() - start;
+      });
+
+      ClientSocket publisher("127.0.0.1", port);
+      Clock::time_point start = Clock::now();
+
+      for (size_t sent = 0; sent < messages; sent += BATCH) {
+        publisher << batch;
+        size_t want = (sent + BATCH) * line * subscribers;
+        while (received < want) loop.run_once(1000);
+      }
+
+      double secs = std::chrono::duration<double>(Clock::now() - start).count();
+
+      uint64_t one = 1;
+      ssize_t n = write(wake, &one, sizeof(one));
+      (void)n;
+      server_thread.join();
+      server.reactor().loop().remove(wake);
+      close(wake);
+
+      size_t deliveries = messages * subscribers;
+      std::cout << names[mode] << ": " << deliveries / secs / 1e3
+                << "k deliveries/s, server CPU " << cpu / deliveries * 1e9
+                << " ns/delivery, " << server.reactor().buffers().allocations()
+                << " pool buffers\n";
+      for (size_t i = 0; i < subscribers; i++) loop.remove(subs[i].fd());
+    }
+  }
+  catch (SocketException& e) {
+    std::cout << "Exception was caught:" << e.description() << "\n";
+  }
+  return 0;
+}
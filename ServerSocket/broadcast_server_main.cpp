@@ -0,0 +1,31 @@
+// Topic broadcast server: clients send SUB, UNSUB and PUB lines
+
+#include "BroadcastServer.h"
+#include "ServerSocket.h"
+#include "SocketException.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+int main(int argc, const char *argv[]) {
+  // usage: broadcast_server [port] [drop|conflate] [queue_kb]
+  // A subscriber with more than queue_kb queued is dropped, or gets only
+  // the newest message per topic until it catches up.
+  int port = argc > 1 ? std::atoi(argv[1]) : 30090;
+  bool conflate = argc > 2 && std::strcmp(argv[2], "conflate") == 0;
+  size_t queue = (argc > 3 ? std::atoi(argv[3]) : 1024) * size_t(1024);
+
+  try {
+    ServerSocket listener(port, false, SOMAXCONN);
+    BroadcastServer server(listener, conflate ? SLOW_CONFLATE : SLOW_DROP);
+    server.reactor().set_watermarks(queue / 4, queue);
+
+    std::cout << "Broadcasting on port " << port << ", slow subscribers "
+              << (conflate ? "conflated" : "dropped") << "\n";
+    server.run();
+  }
+  catch (SocketException& e) {
+    std::cout << "Exception was caught:" << e.description() << "\nExiting\n";
+  }
+  return 0;
+}
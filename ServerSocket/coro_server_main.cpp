@@ -0,0 +1,69 @@
+// Echo server written as coroutines: one straight-line Task per
+// connection, all sharing one thread (or one thread per listener shard)
+
+#include "AsyncSocket.h"
+#include "Executor.h"
+#include "ServerSocket.h"
+#include "SocketException.h"
+#include "Task.h"
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+Task serve(std::unique_ptr<AsyncSocket> conn) {
+  char buf[MAXRECV];
+  while (true) {
+    ssize_t n = co_await conn->async_recv(buf);
+    if (n <= 0) co_return;
+    if (!co_await conn->async_send(std::string_view(buf, n))) co_return;
+  }
+}
+
+Task accept_loop(AsyncSocket& listener) {
+  while (true) {
+    SocketResult<std::unique_ptr<AsyncSocket>> conn =
+        co_await listener.async_accept();
+    if (conn) {
+      serve(std::move(*conn));
+    } else {
+      // Out of descriptors or memory: give connections time to close
+      // rather than retry against a listener that stays readable.
+      co_await listener.executor().sleep(ACCEPT_BACKOFF_MS);
+    }
+  }
+}
+
+static void run_shard(int port, bool reuse_port) {
+  try {
+    Executor exec;
+    AsyncSocket listener(exec, ServerSocket(port, reuse_port, SOMAXCONN));
+    accept_loop(listener);
+    exec.run();
+  }
+  catch (SocketException& e) {
+    std::cout << "Exception was caught:" << e.description() << "\nExiting\n";
+  }
+}
+
+int main(int argc, const char *argv[]) {
+  // usage: coro_server [port] [threads]
+  int port = argc > 1 ? std::atoi(argv[1]) : 30000;
+  int threads = argc > 2 ? std::atoi(argv[2]) : 1;
+
+  if (threads <= 1) {
+    run_shard(port, false);
+    return 0;
+  }
+
+  // Several threads: each runs its own Executor on a SO_REUSEPORT
+  // listener, so connections never migrate between threads.
+  std::vector<std::thread> shards;
+  for (int i = 0; i < threads; i++)
+    shards.push_back(std::thread(run_shard, port, true));
+  for (size_t i = 0; i < shards.size(); i++)
+    shards[i].join();
+  return 0;
+}
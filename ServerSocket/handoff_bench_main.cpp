@@ -0,0 +1,113 @@
+// Compares HandoffQueue with a mutex and condition variable queue, the
+// kind ThreadPoolServer uses: producer threads hand integers (stand-ins
+// for accepted descriptors) to one consumer as fast as they can.
+
+#include "EventLoop.h"
+#include "HandoffQueue.h"
+#include "SocketException.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+const size_t CAPACITY = 1024;
+
+class LockedQueue {
+ public:
+  void push(int v) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_full_.wait(lock, [this] { return queue_.size() < CAPACITY; });
+    queue_.push_back(v);
+    not_empty_.notify_one();
+  }
+
+  int pop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [this] { return !queue_.empty(); });
+    int v = queue_.front();
+    queue_.pop_front();
+    not_full_.notify_one();
+    return v;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+  std::deque<int> queue_;
+};
+
+static double run_locked(size_t producers, size_t items) {
+  LockedQueue q;
+  std::vector<std::thread> threads;
+  Clock::time_point start = Clock::now();
+
+  for (size_t p = 0; p < producers; p++)
+    threads.push_back(std::thread([&q, items] {
+      for (size_t i = 0; i < items; i++) q.push(i);
+    }));
+
+  for (size_t i = 0; i < producers * items; i++) q.pop();
+  for (std::thread& t : threads) t.join();
+
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static double run_handoff(size_t producers, size_t items, uint64_t* wakeups) {
+  HandoffQueue<int> q(CAPACITY);
+  EventLoop loop;
+  size_t got = 0, want = producers * items;
+
+  // The consumer is an event loop, as a worker shard would be.
+  loop.add(q.fd(), [&] {
+    (*wakeups)++;
+    q.clear_wakeup();
+    int v;
+    while (q.pop(v)) got++;
+    if (got == want) loop.stop();
+  });
+
+  std::vector<std::thread> threads;
+  Clock::time_point start = Clock::now();
+
+  for (size_t p = 0; p < producers; p++)
+    threads.push_back(std::thread([&q, items] {
+      for (size_t i = 0; i < items; i++)
+        while (!q.push(i)) std::this_thread::yield();
+    }));
+
+  loop.run();
+  for (std::thread& t : threads) t.join();
+  loop.remove(q.fd());
+
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+int main(int argc, const char *argv[]) {
+  // usage: handoff_bench [producers] [items per producer]
+  size_t producers = argc > 1 ? std::atoi(argv[1]) : 4;
+  size_t items = argc > 2 ? std::atoi(argv[2]) : 1000000;
+  double total = producers * items;
+
+  try {
+    double locked = run_locked(producers, items);
+    uint64_t wakeups = 0;
+    double handoff = run_handoff(producers, items, &wakeups);
+
+    std::cout << producers << " producers, " << items << " items each\n"
+              << "mutex+condvar: " << total / locked / 1e6 << " M items/s\n"
+              << "HandoffQueue:  " << total / handoff / 1e6 << " M items/s, "
+              << total / wakeups << " items per eventfd wakeup\n";
+  }
+  catch (SocketException& e) {
+    std::cout << "Exception was caught:" << e.description() << "\n";
+    return 1;
+  }
+  return 0;
+}
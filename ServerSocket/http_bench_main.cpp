@@ -0,0 +1,187 @@
+// Measures HttpParser's SSE2 delimiter scan against a plain byte-at-a-time
+// scan (and memchr), on its own and inside full request parsing, then
+// drives HttpServer over loopback with pipelined keep-alive requests.
+
+#include "ClientSocket.h"
+#include "HttpParser.h"
+#include "HttpServer.h"
+#include "ServerSocket.h"
+#include "SocketException.h"
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+// What curl sends, and what a browser sends.
+const char* SHORT_REQUEST =
+    "GET /health HTTP/1.1\r\n"
+    "Host: localhost:30080\r\n"
+    "User-Agent: curl/7.88.1\r\n"
+    "Accept: */*\r\n"
+    "\r\n";
+
+const char* LONG_REQUEST =
+    "GET /static/js/app.4f9c2b1e.js?v=20240117 HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "Connection: keep-alive\r\n"
+    "sec-ch-ua: \"Chromium\";v=\"122\", \"Not(A:Brand\";v=\"24\"\r\n"
+    "sec-ch-ua-mobile: ?0\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 "
+    "(KHTML, like Gecko) Chrome/122.0.0.0 Safari/537.36\r\n"
+    "sec-ch-ua-platform: \"Linux\"\r\n"
+    "Accept: */*\r\n"
+    "Sec-Fetch-Site: same-origin\r\n"
+    "Sec-Fetch-Mode: no-cors\r\n"
+    "Sec-Fetch-Dest: script\r\n"
+    "Referer: https://www.example.com/account/settings/notifications\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Accept-Language: en-GB,en-US;q=0.9,en;q=0.8\r\n"
+    "Cookie: session=9b2f6c1e4d8a7f3b5c0e2d4a6b8c0e1f; theme=dark; "
+    "_ga=GA1.2.1234567890.1700000000; consent=analytics%3Dno\r\n"
+    "\r\n";
+
+const char* RESPONSE =
+    "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: 3\r\n"
+    "Connection: keep-alive\r\n\r\nok\n";
+
+typedef const char* (*Finder)(const char*, const char*, char);
+
+static const char* find_memchr(const char* p, const char* end, char c) {
+  return static_cast<const char*>(std::memchr(p, c, end - p));
+}
+
+static double elapsed(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Counts the lines in buf, rounds times over.
+static void bench_scan(const char* name, Finder find, const std::string& buf,
+                       int rounds) {
+  size_t lines = 0;
+  Clock::time_point start = Clock::now();
+  for (int r = 0; r < rounds; r++) {
+    const char* end = buf.data() + buf.size();
+    for (const char* p = buf.data(); (p = find(p, end, '\n')); p++) lines++;
+  }
+  double secs = elapsed(start);
+  std::cout << "  scan " << name << ": " << buf.size() * rounds / secs / 1e6
+            << " MB/s (" << lines / rounds << " lines)\n";
+}
+
+// Parses the same request over and over, as a server would.
+static void bench_parse(const char* name, bool simd, const std::string& req,
+                        int rounds) {
+  HttpParser parser(simd);
+  HttpRequest r;
+  size_t headers = 0;
+  Clock::time_point start = Clock::now();
+  for (int i = 0; i < rounds; i++) {
+    if (parser.parse(req, r) != HttpParser::HTTP_COMPLETE) {
+      std::cout << "parse failed\n";
+      return;
+    }
+    headers += r.header_count;
+    parser.reset();
+  }
+  double secs = elapsed(start);
+  std::cout << "  parse " << name << ": " << rounds / secs / 1e6
+            << " M requests/s, " << req.size() * rounds / secs / 1e6
+            << " MB/s (" << headers / rounds << " headers)\n";
+}
+
+// Keeps depth requests in flight on each connection for secs seconds.
+static void bench_server(int port, size_t conns, size_t depth, double secs) {
+  std::vector<ClientSocket> clients;
+  for (size_t i = 0; i < conns; i++)
+    clients.push_back(ClientSocket("127.0.0.1", port));
+
+  std::string batch;
+  for (size_t i = 0; i < depth; i++)
+    batch += "GET /health HTTP/1.1\r\nHost: localhost\r\n\r\n";
+
+  size_t want = depth * std::strlen(RESPONSE);
+  std::vector<char> buf(64 * 1024);
+  size_t answered = 0;
+  Clock::time_point start = Clock::now();
+
+  while (elapsed(start) < secs) {
+    for (size_t i = 0; i < conns; i++) clients[i].send({batch});
+
+    for (size_t i = 0; i < conns; i++) {
+      size_t got = 0;
+      while (got < want) {
+        ssize_t n = clients[i].read_some(&buf[0], buf.size());
+        if (n <= 0) {
+          std::cout << "connection lost\n";
+          return;
+        }
+        if (got == 0 && std::memcmp(&buf[0], RESPONSE, std::strlen(RESPONSE))) {
+          std::cout << "unexpected response\n";
+          return;
+        }
+        got += n;
+      }
+      answered += depth;
+    }
+  }
+
+  double t = elapsed(start);
+  std::cout << "  " << conns << " connections, depth " << depth << ": "
+            << answered / t << " requests/s\n";
+}
+
+int main(int argc, const char *argv[]) {
+  // usage: http_bench [port] [seconds]
+  int port = argc > 1 ? std::atoi(argv[1]) : 30080;
+  double secs = argc > 2 ? std::atof(argv[2]) : 2;
+
+  const char* names[] = { "short", "long" };
+  const char* requests[] = { SHORT_REQUEST, LONG_REQUEST };
+
+  for (int i = 0; i < 2; i++) {
+    std::string req = requests[i];
+    std::string many;
+    while (many.size() < 1024 * 1024) many += req;
+
+    std::cout << names[i] << " request, " << req.size() << " bytes:\n";
+    bench_scan("sse2", HttpParser::find, many, 200);
+    bench_scan("bytewise", HttpParser::find_bytewise, many, 200);
+    bench_scan("memchr", find_memchr, many, 200);
+    bench_parse("sse2", true, req, 2000000 / (i * 4 + 1));
+    bench_parse("bytewise", false, req, 2000000 / (i * 4 + 1));
+  }
+
+  try {
+    ServerSocket listener(port, false, SOMAXCONN);
+    HttpServer server(listener);
+    server.route("/health", "ok\n");
+
+    // Written from here to stop the server from its own thread.
+    int wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    server.reactor().loop().add(wake, [&] { server.stop(); });
+    std::thread server_thread([&] { server.run(); });
+
+    std::cout << "loopback keep-alive GET /health:\n";
+    bench_server(port, 1, 1, secs);
+    bench_server(port, 16, 1, secs);
+    bench_server(port, 16, 16, secs);
+
+    uint64_t one = 1;
+    ssize_t n = write(wake, &one, sizeof(one));
+    (void)n;
+    server_thread.join();
+    server.reactor().loop().remove(wake);
+    close(wake);
+  }
+  catch (SocketException& e) {
+    std::cout << "Exception was caught:" << e.description() << "\n";
+  }
+  return 0;
+}
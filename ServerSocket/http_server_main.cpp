@@ -0,0 +1,37 @@
+// Keep-alive HTTP server answering health checks and socket metrics
+
+#include "HttpServer.h"
+#include "ServerSocket.h"
+#include "SocketException.h"
+#include "SocketMetrics.h"
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+int main(int argc, const char *argv[]) {
+  // usage: http_server [port] [idle_seconds]
+  int port = argc > 1 ? std::atoi(argv[1]) : 30080;
+  int idle = argc > 2 ? std::atoi(argv[2]) : 60;
+
+  try {
+    ServerSocket listener(port, false, SOMAXCONN);
+    HttpServer server(listener);
+
+    server.route("/", "hello\n");
+    server.route("/health", "ok\n");
+    server.route("/metrics", [] { return SocketMetrics::text(); });
+    server.route("/metrics.json", [] { return SocketMetrics::json(); },
+                 "application/json");
+
+    // Idle keep-alive connections are closed rather than kept forever.
+    if (idle > 0)
+      server.reactor().set_timeouts(idle * 1000, idle * 1000, idle * 1000);
+
+    std::cout << "Serving HTTP on port " << port << "\n";
+    server.run();
+  }
+  catch (SocketException& e) {
+    std::cout << "Exception was caught:" << e.description() << "\nExiting\n";
+  }
+  return 0;
+}
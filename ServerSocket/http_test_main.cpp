@@ -0,0 +1,219 @@
+// Checks HttpParser and HttpServer against the cases that are easy to get
+// wrong: a head arriving in pieces, ambiguous framing, oversized heads and
+// pipelined keep-alive requests ending in a close. Exits non-zero on any
+// failure.
+
+#include "ClientSocket.h"
+#include "HttpParser.h"
+#include "HttpServer.h"
+#include "ServerSocket.h"
+#include "SocketException.h"
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                  \
+  do {                                                               \
+    if (!(cond)) {                                                   \
+      std::cout << __FILE__ << ":" << __LINE__ << ": failed: " #cond \
+                << "\n";                                             \
+      failures++;                                                    \
+    }                                                                \
+  } while (0)
+
+static HttpParser::Status parse(std::string_view buf, bool simd = true) {
+  HttpParser p(simd);
+  HttpRequest req;
+  return p.parse(buf, req);
+}
+
+static void split_heads() {
+  const std::string head =
+      "GET /status?verbose=1 HTTP/1.1\r\n"
+      "Host: example.com\r\n"
+      "User-Agent: http_test\r\n"
+      "Content-Length: 5\r\n"
+      "Connection: keep-alive\r\n"
+      "\r\n";
+  const std::string buf = head + "hello" + "GET / HTTP/1.0\r\n\r\n";
+
+  for (int simd = 0; simd < 2; simd++) {
+    // Split once at every offset: the first part is never enough, the
+    // whole head always is.
+    for (size_t k = 1; k < head.size(); k++) {
+      HttpParser p(simd);
+      HttpRequest req;
+      CHECK(p.parse(std::string_view(buf).substr(0, k), req) ==
+            HttpParser::HTTP_INCOMPLETE);
+      CHECK(p.parse(buf, req) == HttpParser::HTTP_COMPLETE);
+      CHECK(p.consumed() == head.size());
+      CHECK(req.target == "/status?verbose=1");
+      CHECK(req.content_length == 5);
+      CHECK(req.header("host") == "example.com");
+      CHECK(req.keep_alive);
+    }
+
+    // One byte at a time on the same parser, resuming each time.
+    HttpParser p(simd);
+    HttpRequest req;
+    size_t k = 1;
+    while (k < head.size() &&
+           p.parse(std::string_view(buf).substr(0, k), req) ==
+               HttpParser::HTTP_INCOMPLETE)
+      k++;
+    CHECK(k == head.size());
+    CHECK(p.parse(std::string_view(buf).substr(0, k), req) ==
+          HttpParser::HTTP_COMPLETE);
+    CHECK(p.consumed() == head.size());
+
+    // The next pipelined request starts after the head and its body.
+    p.reset();
+    CHECK(p.parse(std::string_view(buf).substr(head.size() + 5), req) ==
+          HttpParser::HTTP_COMPLETE);
+    CHECK(req.version == 0 && !req.keep_alive);
+  }
+}
+
+static void framing() {
+  CHECK(parse("POST / HTTP/1.1\r\nContent-Length: 5\r\n"
+              "Content-Length: 6\r\n\r\n") == HttpParser::HTTP_ERROR);
+  CHECK(parse("POST / HTTP/1.1\r\nContent-Length: 5\r\n"
+              "Content-Length: 5\r\n\r\n") == HttpParser::HTTP_COMPLETE);
+  CHECK(parse("POST / HTTP/1.1\r\nContent-Length: 5x\r\n\r\n") ==
+        HttpParser::HTTP_ERROR);
+  CHECK(parse("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n"
+              "Content-Length: 5\r\n\r\n") == HttpParser::HTTP_ERROR);
+  CHECK(parse("POST / HTTP/1.1\r\nContent-Length: 5\r\n"
+              "Transfer-Encoding: gzip, chunked\r\n\r\n") ==
+        HttpParser::HTTP_ERROR);
+
+  HttpParser p;
+  HttpRequest req;
+  CHECK(p.parse("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n",
+                req) == HttpParser::HTTP_COMPLETE);
+  CHECK(req.chunked);
+}
+
+static void limits() {
+  std::string big = "GET / HTTP/1.1\r\nX-Big: " +
+                    std::string(HTTP_MAX_HEAD, 'b') + "\r\n\r\n";
+  CHECK(parse(big) == HttpParser::HTTP_TOO_LARGE);
+  CHECK(parse(big, false) == HttpParser::HTTP_TOO_LARGE);
+
+  // Still unterminated past the limit: refused, not waited on forever.
+  CHECK(parse(std::string_view(big).substr(0, HTTP_MAX_HEAD + 16)) ==
+        HttpParser::HTTP_TOO_LARGE);
+
+  std::string headers;
+  for (size_t i = 0; i < HTTP_MAX_HEADERS; i++)
+    headers += "X-" + std::to_string(i) + ": v\r\n";
+  CHECK(parse("GET / HTTP/1.1\r\n" + headers + "\r\n") ==
+        HttpParser::HTTP_COMPLETE);
+  CHECK(parse("GET / HTTP/1.1\r\n" + headers + "X-More: v\r\n\r\n") ==
+        HttpParser::HTTP_TOO_LARGE);
+}
+
+// Everything the server sends until it closes the connection.
+static std::string exchange(int port, const std::string& request,
+                            bool bytewise) {
+  ClientSocket c("127.0.0.1", port);
+  timeval tv = {5, 0};
+  setsockopt(c.fd(), SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+  if (bytewise) {
+    c.set_profile(PROFILE_LOW_LATENCY);
+    for (size_t i = 0; i < request.size(); i++)
+      c.try_send(request.substr(i, 1));
+  } else {
+    c.try_send(request);
+  }
+
+  std::string out, chunk;
+  while (true) {
+    SocketResult<size_t> n = c.try_recv(chunk);
+    if (!n || *n == 0) break;
+    out += chunk;
+  }
+  return out;
+}
+
+static size_t count(const std::string& s, const std::string& what) {
+  size_t n = 0;
+  for (size_t pos = s.find(what); pos != std::string::npos;
+       pos = s.find(what, pos + 1))
+    n++;
+  return n;
+}
+
+static void server(int port) {
+  ServerSocket listener(port, false, SOMAXCONN);
+  HttpServer server(listener);
+  server.route("/", "hello\n");
+  server.route("/health", "ok\n");
+
+  int wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  server.reactor().loop().add(wake, [&] { server.stop(); });
+  std::thread t([&] { server.run(); });
+
+  // Pipelined keep-alive requests in one write, one with a body to skip
+  // and the last asking to close: four answers, then the connection
+  // goes. The request after the close is never answered.
+  std::string keep = "GET /health HTTP/1.1\r\nHost: a\r\n\r\n";
+  std::string body = "GET /health HTTP/1.1\r\nContent-Length: 4\r\n\r\nbody";
+  std::string close = "GET / HTTP/1.1\r\nConnection: close\r\n\r\n";
+  std::string out = exchange(port, keep + body + keep + close + keep, false);
+  CHECK(count(out, "HTTP/1.1 200") == 4);
+  CHECK(count(out, "HTTP/1.1 ") == 4);
+  CHECK(out.size() >= 6 && out.compare(out.size() - 6, 6, "hello\n") == 0);
+
+  // A head that comes a byte per segment is still answered once.
+  out = exchange(port, "GET /health HTTP/1.1\r\nConnection: close\r\n\r\n",
+                 true);
+  CHECK(count(out, "HTTP/1.1 200") == 1);
+
+  // Ambiguous framing and oversized heads are refused and closed.
+  out = exchange(port, "GET / HTTP/1.1\r\nContent-Length: 1\r\n"
+                 "Content-Length: 2\r\n\r\n", false);
+  CHECK(out.compare(0, 12, "HTTP/1.1 400") == 0);
+  out = exchange(port, "GET / HTTP/1.1\r\nX-Big: " +
+                 std::string(2 * HTTP_MAX_HEAD, 'b') + "\r\n\r\n", false);
+  CHECK(out.compare(0, 12, "HTTP/1.1 431") == 0);
+
+  uint64_t one = 1;
+  ssize_t n = write(wake, &one, sizeof(one));
+  (void)n;
+  t.join();
+  server.reactor().loop().remove(wake);
+  ::close(wake);
+}
+
+int main(int argc, const char *argv[]) {
+  // usage: http_test [port]
+  int port = argc > 1 ? std::atoi(argv[1]) : 30081;
+
+  split_heads();
+  framing();
+  limits();
+
+  try {
+    server(port);
+  }
+  catch (SocketException& e) {
+    std::cout << "Exception was caught:" << e.description() << "\n";
+    failures++;
+  }
+
+  if (failures) {
+    std::cout << failures << " checks failed\n";
+    return 1;
+  }
+  std::cout << "All checks passed\n";
+  return 0;
+}
@@ -0,0 +1,59 @@
+// Times short request/response exchanges against the echo server, once
+// with a fresh ClientSocket per request and once through ClientSocketPool
+
+#include "ClientSocket.h"
+#include "ClientSocketPool.h"
+#include "SocketException.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static void report(const char *label, std::vector<double>& us) {
+  std::sort(us.begin(), us.end());
+  std::cout << label << ": p50 " << us[us.size() / 2] << " us, p99 "
+            << us[us.size() * 99 / 100] << " us\n";
+}
+
+int main(int argc, const char *argv[]) {
+  // usage: pooled_client [host] [port] [requests]
+  std::string host = argc > 1 ? argv[1] : "127.0.0.1";
+  int port = argc > 2 ? std::atoi(argv[2]) : 30000;
+  int requests = argc > 3 ? std::atoi(argv[3]) : 1000;
+  if (requests < 1) requests = 1;
+
+  try {
+    std::vector<double> fresh, pooled;
+    std::string reply;
+
+    for (int i = 0; i < requests; i++) {
+      Clock::time_point start = Clock::now();
+      ClientSocket sock(host, port);
+      sock << "ping";
+      sock >> reply;
+      fresh.push_back(std::chrono::duration<double, std::micro>(
+          Clock::now() - start).count());
+    }
+
+    ClientSocketPool pool;
+    for (int i = 0; i < requests; i++) {
+      Clock::time_point start = Clock::now();
+      ClientSocketPool::Lease sock = pool.acquire(host, port);
+      *sock << "ping";
+      *sock >> reply;
+      pooled.push_back(std::chrono::duration<double, std::micro>(
+          Clock::now() - start).count());
+    }
+
+    report("new connection", fresh);
+    report("pooled", pooled);
+  }
+  catch (SocketException& e) {
+    std::cout << "Exception was caught:" << e.description() << "\n";
+  }
+  return 0;
+}
@@ -0,0 +1,90 @@
+// Compares SpliceProxy's splice relay with its recv/send copy relay: a
+// client pushes data through the proxy to an upstream sink that echoes a
+// byte count back, and the proxy thread's CPU time is measured.
+
+#include "ServerSocket.h"
+#include "ClientSocket.h"
+#include "SocketException.h"
+#include "SpliceProxy.h"
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+const size_t CHUNK = 1024 * 1024;
+
+static double thread_cpu() {
+  rusage ru;
+  getrusage(RUSAGE_THREAD, &ru);
+  return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec +
+         (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+// Reads until the client half-closes, then answers with "done".
+static void sink(ServerSocket* server) {
+  ServerSocket conn = server->accept();
+  std::vector<char> buf(256 * 1024);
+  while (conn.read_some(&buf[0], buf.size()) > 0) {
+  }
+  conn << std::string_view("done");
+}
+
+int main(int argc, const char *argv[]) {
+  // usage: proxy_bench [port] [MB]
+  int port = argc > 1 ? std::atoi(argv[1]) : 30000;
+  size_t total = (argc > 2 ? std::atoi(argv[2]) : 1024) * size_t(1024 * 1024);
+  total -= total % CHUNK;
+  if (total == 0) total = CHUNK;
+
+  const char* names[] = { "splice", "copy" };
+
+  try {
+    ServerSocket upstream(port);
+    ServerSocket front(port + 1);
+    std::string data(CHUNK, 'p');
+
+    for (int mode = 0; mode < 2; mode++) {
+      SpliceProxy proxy(front, "127.0.0.1", port, mode == 0);
+      std::atomic<bool> done(false);
+      double cpu = 0;
+
+      std::thread upstream_thread(sink, &upstream);
+      std::thread proxy_thread([&] {
+        double start = thread_cpu();
+        while (!done) proxy.loop().run_once(100);
+        cpu = thread_cpu() - start;
+      });
+
+      Clock::time_point start = Clock::now();
+      {
+        ClientSocket client("127.0.0.1", port + 1);
+        for (size_t sent = 0; sent < total; sent += CHUNK) client << data;
+        ::shutdown(client.fd(), SHUT_WR);
+
+        std::string reply;
+        client >> reply;
+      }
+      double secs = std::chrono::duration<double>(Clock::now() - start).count();
+
+      upstream_thread.join();
+      done = true;
+      proxy_thread.join();
+
+      ProxyStats st = proxy.totals();
+      std::cout << names[mode] << ": " << total / secs / 1e6 << " MB/s, proxy CPU "
+                << cpu / (total / 1e9) * 1e3 << " ms/GB, relayed "
+                << st.upstream << " up / " << st.downstream << " down\n";
+    }
+  }
+  catch (SocketException& e) {
+    std::cout << "Exception was caught:" << e.description() << "\n";
+  }
+  return 0;
+}
@@ -0,0 +1,34 @@
+// TCP forwarder: relays every connection to an upstream server with
+// SpliceProxy and prints what each one moved when it closes.
+
+#include "ServerSocket.h"
+#include "SocketException.h"
+#include "SpliceProxy.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+int main(int argc, const char *argv[]) {
+  // usage: proxy [listen port] [upstream host] [upstream port] [splice|copy]
+  int port = argc > 1 ? std::atoi(argv[1]) : 30001;
+  std::string host = argc > 2 ? argv[2] : "127.0.0.1";
+  int upstream = argc > 3 ? std::atoi(argv[3]) : 30000;
+  bool splice = !(argc > 4 && std::strcmp(argv[4], "copy") == 0);
+
+  try {
+    ServerSocket server(port);
+    SpliceProxy proxy(server, host, upstream, splice);
+
+    proxy.on_close([](int fd, const ProxyStats& st) {
+      std::cout << "connection " << fd << ": " << st.upstream << " bytes up, "
+                << st.downstream << " bytes down\n";
+    });
+
+    proxy.run();
+  }
+  catch (SocketException& e) {
+    std::cout << "Exception was caught:" << e.description() << "\nExiting\n";
+  }
+  return 0;
+}
@@ -0,0 +1,47 @@
+// Echo server that multiplexes every connection on one thread with EventLoop
+
+#include "MetricsEndpoint.h"
+#include "ServerSocket.h"
+#include "SocketException.h"
+#include "ReactorServer.h"
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+
+int main(int argc, const char *argv[]) {
+  // usage: reactor_server [port|path] [backlog] [idle_seconds] [admin_path]
+  // A path (e.g. /tmp/echo.sock or @echo) serves a local socket. Socket
+  // metrics are served on admin_path if one is given.
+  std::string where = argc > 1 ? argv[1] : "30000";
+  bool local = where[0] == '/' || where[0] == '@' || where[0] == '.';
+  int backlog = argc > 2 ? std::atoi(argv[2]) : SOMAXCONN;
+  int idle = argc > 3 ? std::atoi(argv[3]) : 0;
+  std::string admin = argc > 4 ? argv[4] : "";
+
+  try {
+    std::unique_ptr<ServerSocket> server(local
+        ? new ServerSocket(where, backlog)
+        : new ServerSocket(std::atoi(where.c_str()), false, backlog));
+
+    std::unique_ptr<MetricsEndpoint> metrics;
+    if (!admin.empty()) metrics.reset(new MetricsEndpoint(admin));
+
+    ReactorServer reactor(*server,
+        [](ReactorServer::Connection& conn, std::string_view data) {
+          conn.send(data);
+        });
+
+    // A peer that connects and never sends, or stops reading its
+    // replies, is dropped instead of holding a descriptor forever.
+    if (idle > 0)
+      reactor.set_timeouts(idle * 1000, idle * 1000, idle * 1000);
+
+    reactor.run();
+  }
+  catch (SocketException& e) {
+    std::cout << "Exception was caught:" << e.description() << "\nExiting\n";
+  }
+  return 0;
+}
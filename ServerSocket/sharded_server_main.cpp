@@ -0,0 +1,37 @@
+// Echo server with one SO_REUSEPORT listener and event loop per core
+
+#include "MetricsEndpoint.h"
+#include "ShardedServer.h"
+#include "SocketException.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+
+int main(int argc, const char *argv[]) {
+  // usage: sharded_server [port] [shards] [pin|nopin] [admin_path]
+  int port = argc > 1 ? std::atoi(argv[1]) : 30000;
+  size_t shards = argc > 2 ? std::atoi(argv[2]) : 0;
+  bool pin = argc > 3 && std::strcmp(argv[3], "pin") == 0;
+  std::string admin = argc > 4 ? argv[4] : "";
+
+  try {
+    ShardedServer server(port,
+        [](ReactorServer::Connection& conn, std::string_view data) {
+          conn.send(data);
+        }, shards, pin);
+
+    // Counters from every shard, added up per request.
+    std::unique_ptr<MetricsEndpoint> metrics;
+    if (!admin.empty()) metrics.reset(new MetricsEndpoint(admin));
+
+    std::cout << "Serving with " << server.shards() << " shards\n";
+    server.run();
+  }
+  catch (SocketException& e) {
+    std::cout << "Exception was caught:" << e.description() << "\nExiting\n";
+  }
+  return 0;
+}
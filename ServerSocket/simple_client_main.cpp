@@ -1,4 +1,4 @@
-# Copyright[2002] <Copyright Rob Tougher>
+// Copyright[2002] <Copyright Rob Tougher>
 
 #include "ClientSocket.h"
 #include "SocketException.h"
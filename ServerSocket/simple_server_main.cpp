@@ -1,30 +1,50 @@
-# Copyright[2002] <Copyright Rob Tougher>
+// Copyright[2002] <Copyright Rob Tougher>
 
 #include "ServerSocket.h"
 #include "SocketException.h"
 #include <string>
+#include <cstring>
+#include <string_view>
 #include <iostream>
+#include <vector>
 
 
 int main(int argc, const char *argv[]) {
+  // usage: simple_server [framed]
+  // framed echoes length-prefixed messages (see Socket::send_message)
+  // instead of raw bytes.
+  bool framed = argc > 1 && std::strcmp(argv[1], "framed") == 0;
+
   try {
     // Create the socket
     ServerSocket server(30000);
 
     while (true) {
-      ServerSocket new_sock;
-      server.accept(new_sock);
+      ServerSocket new_sock = server.accept();
 
       // rest of code -
       // read request, send reply, etc...
-      try {
+      // data views the socket's receive buffer, so echoing it back
+      // needs no allocation or copy. A peer closing is routine, so the
+      // loop uses the non-throwing calls rather than unwinding.
+      if (framed) {
+        // Every message a pipelining client has already sent is answered
+        // in one gathered write: two syscalls per batch, not per message.
+        std::vector<std::string_view> messages;
         while (true) {
-          std::string data;
-          new_sock >> data;
-          new_sock << data;
+          SocketResult<size_t> n = new_sock.try_recv_messages(messages);
+          if (!n || *n == 0 || !new_sock.try_send_messages(messages))
+            break;
         }
+        continue;
+      }
+
+      std::string_view data;
+      while (true) {
+        SocketResult<size_t> n = new_sock.try_recv(data);
+        if (!n || *n == 0 || !new_sock.try_send(data))
+          break;
       }
-      catch (SocketException&) {}
     }
   }
   catch (SocketException& e) {
@@ -0,0 +1,133 @@
+// Shows what each SocketProfile does over loopback: round trip latency of
+// a request written in two pieces (header, then body - the pattern that
+// stalls on Nagle plus delayed ACKs), and throughput of a bulk transfer
+// made of small writes. Both ends use the profile under test.
+
+#include "ClientSocket.h"
+#include "LatencyHistogram.h"
+#include "ServerSocket.h"
+#include "SocketException.h"
+#include <sys/socket.h>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+const size_t HEADER = 16;
+const size_t BODY = 64;
+const size_t REPLY = 64;
+const size_t MAX_ROUND_TRIPS = 20000;
+
+static double elapsed(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static bool read_exactly(const ServerSocket& s, char* buf, size_t len) {
+  for (size_t got = 0; got < len;) {
+    ssize_t n = s.read_some(buf + got, len - got);
+    if (n <= 0) return false;
+    got += n;
+  }
+  return true;
+}
+
+static bool read_exactly(const ClientSocket& s, char* buf, size_t len) {
+  for (size_t got = 0; got < len;) {
+    ssize_t n = s.read_some(buf + got, len - got);
+    if (n <= 0) return false;
+    got += n;
+  }
+  return true;
+}
+
+// Answers each header + body with a reply until the client goes.
+static void responder(ServerSocket* listener, int profile) {
+  ServerSocket conn = listener->accept();
+  if (profile) conn.set_profile(profile);
+  std::string reply(REPLY, 'r');
+  char buf[HEADER + BODY];
+  while (read_exactly(conn, buf, sizeof(buf))) conn.try_send(reply);
+}
+
+static void latency(ServerSocket& listener, int port, int profile,
+                    double secs) {
+  std::thread server(responder, &listener, profile);
+  LatencyHistogram h;
+  {
+    ClientSocket c("127.0.0.1", port);
+    if (profile) c.set_profile(profile);
+    std::string header(HEADER, 'h'), body(BODY, 'b');
+    char reply[REPLY];
+    Clock::time_point start = Clock::now();
+    while (h.count() < MAX_ROUND_TRIPS && elapsed(start) < secs) {
+      Clock::time_point t = Clock::now();
+      c.try_send(header);
+      c.try_send(body);
+      if (!read_exactly(c, reply, sizeof(reply))) break;
+      h.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   Clock::now() - t).count());
+    }
+  }
+  server.join();
+  std::cout << "  latency: " << h.count() << " round trips, mean "
+            << h.mean() / 1e3 << " us, p50 " << h.percentile(0.5) / 1e3
+            << " us, p99 " << h.percentile(0.99) / 1e3 << " us\n";
+}
+
+static void sink(ServerSocket* listener, int profile) {
+  ServerSocket conn = listener->accept();
+  if (profile) conn.set_profile(profile);
+  std::vector<char> buf(256 * 1024);
+  while (conn.read_some(&buf[0], buf.size()) > 0) {
+  }
+  conn.try_send("done");
+}
+
+static void throughput(ServerSocket& listener, int port, int profile,
+                       size_t total, size_t write_size) {
+  std::thread server(sink, &listener, profile);
+  Clock::time_point start = Clock::now();
+  int sndbuf = 0;
+  {
+    ClientSocket c("127.0.0.1", port);
+    if (profile) c.set_profile(profile);
+    if (c.send_buffer()) sndbuf = *c.send_buffer();
+    std::string data(write_size, 'd');
+    for (size_t sent = 0; sent < total; sent += write_size) c.try_send(data);
+    ::shutdown(c.fd(), SHUT_WR);
+    std::string done;
+    c.try_recv(done);
+  }
+  double t = elapsed(start);
+  server.join();
+  std::cout << "  throughput: " << total / t / 1e6 << " MB/s in "
+            << write_size << " byte writes (SO_SNDBUF " << sndbuf << ")\n";
+}
+
+int main(int argc, const char *argv[]) {
+  // usage: sockopt_bench [port] [MB] [write_size] [latency_seconds]
+  int port = argc > 1 ? std::atoi(argv[1]) : 30070;
+  size_t total = (argc > 2 ? std::atoi(argv[2]) : 256) * size_t(1024 * 1024);
+  size_t write_size = argc > 3 ? std::atoi(argv[3]) : 1024;
+  double secs = argc > 4 ? std::atof(argv[4]) : 2;
+
+  const char* names[] = { "default", "low latency", "bulk", "keepalive" };
+  int profiles[] = { 0, PROFILE_LOW_LATENCY, PROFILE_BULK, PROFILE_KEEPALIVE };
+
+  try {
+    ServerSocket listener(port, false, SOMAXCONN);
+    for (int i = 0; i < 4; i++) {
+      std::cout << names[i] << ":\n";
+      latency(listener, port, profiles[i], secs);
+      throughput(listener, port, profiles[i], total, write_size);
+    }
+  }
+  catch (SocketException& e) {
+    std::cout << "Exception was caught:" << e.description() << "\n";
+  }
+  return 0;
+}
@@ -0,0 +1,42 @@
+// Echo server that hands each connection to a pool of worker threads
+
+#include "ServerSocket.h"
+#include "SocketException.h"
+#include "ThreadPoolServer.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+
+int main(int argc, const char *argv[]) {
+  // usage: threaded_server [port] [threads] [queue size] [block|reject|drop]
+  int port = argc > 1 ? std::atoi(argv[1]) : 30000;
+  size_t threads = argc > 2 ? std::atoi(argv[2]) : 0;
+  size_t queue_size = argc > 3 ? std::atoi(argv[3]) : MAXQUEUED;
+
+  OverloadPolicy policy = OVERLOAD_BLOCK;
+  if (argc > 4 && std::strcmp(argv[4], "reject") == 0)
+    policy = OVERLOAD_REJECT;
+  else if (argc > 4 && std::strcmp(argv[4], "drop") == 0)
+    policy = OVERLOAD_DROP_OLDEST;
+
+  try {
+    ServerSocket server(port);
+
+    ThreadPoolServer pool(server, [](ServerSocket& sock) {
+      std::string_view data;
+      while (true) {
+        SocketResult<size_t> n = sock.try_recv(data);
+        if (!n || *n == 0 || !sock.try_send(data))
+          break;
+      }
+    }, threads, queue_size, policy);
+
+    std::cout << "Serving with " << pool.threads() << " worker threads\n";
+    pool.run();
+  }
+  catch (SocketException& e) {
+    std::cout << "Exception was caught:" << e.description() << "\nExiting\n";
+  }
+  return 0;
+}
@@ -0,0 +1,119 @@
+// UDP packet-rate benchmark for DatagramSocket: a sink that counts what
+// arrives and a blaster that sends fixed-size datagrams as fast as it can.
+
+#include "DatagramSocket.h"
+#include "SocketException.h"
+#include <poll.h>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+typedef std::chrono::steady_clock Clock;
+
+static void usage() {
+  std::cout << "usage: udp_bench recv [port] [seconds] [gro]\n"
+               "       udp_bench send [host] [port] [size] [seconds] [gso]\n";
+}
+
+static double since(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static int run_recv(int port, double seconds, bool gro) {
+  DatagramSocket sock(port);
+  sock.set_receive_buffer(4 * 1024 * 1024);
+  if (gro && !sock.set_gro(true))
+    std::cout << "GRO not supported, continuing without\n";
+
+  uint64_t packets = 0, bytes = 0, batches = 0;
+  Clock::time_point start;
+  pollfd pfd = { sock.fd(), POLLIN, 0 };
+  sock.set_non_blocking(true);
+
+  // The clock starts with the first datagram. poll only runs once the
+  // socket is drained, so a busy sink costs one syscall per batch.
+  while (packets == 0 || since(start) < seconds) {
+    SocketResult<size_t> n = sock.recv_batch();
+    if (!n && n.error() == EAGAIN) {
+      if (::poll(&pfd, 1, 100) <= 0 && packets > 0) break;
+      continue;
+    }
+    if (!n) {
+      std::cout << "recv: " << n.message() << "\n";
+      return 1;
+    }
+
+    if (packets == 0) start = Clock::now();
+    for (const DatagramSocket::Datagram& d : sock.datagrams()) bytes += d.data.size();
+    packets += *n;
+    batches++;
+  }
+
+  double t = since(start);
+  std::cout << packets << " datagrams in " << t << " s: " << (uint64_t)(packets / t)
+            << " pps, " << bytes / t / 1e6 << " MB/s, "
+            << (double)packets / batches << " per recvmmsg\n";
+  return 0;
+}
+
+static int run_send(const std::string& host, int port, size_t size,
+                    double seconds, bool gso) {
+  DatagramSocket sock;
+  if (gso && !sock.set_gso(true))
+    std::cout << "GSO not supported, continuing without\n";
+
+  SocketResult<void> c = sock.connect(host, port);
+  if (!c) {
+    std::cout << "connect: " << c.message() << "\n";
+    return 1;
+  }
+
+  std::string payload(size, 'm');
+  uint64_t packets = 0;
+  Clock::time_point start = Clock::now();
+
+  while (since(start) < seconds) {
+    for (size_t i = 0; i < DGRAM_BATCH; i++) sock.queue(payload);
+
+    SocketResult<size_t> n = sock.flush();
+    if (!n && n.error() != ECONNREFUSED) {
+      std::cout << "send: " << n.message() << "\n";
+      return 1;
+    }
+    packets += n.value();
+  }
+
+  double t = since(start);
+  std::cout << packets << " datagrams in " << t << " s: " << (uint64_t)(packets / t)
+            << " pps, " << packets * size / t / 1e6 << " MB/s\n";
+  return 0;
+}
+
+int main(int argc, const char *argv[]) {
+  try {
+    if (argc > 1 && std::strcmp(argv[1], "recv") == 0) {
+      int port = argc > 2 ? std::atoi(argv[2]) : 30000;
+      double seconds = argc > 3 ? std::atof(argv[3]) : 5;
+      bool gro = argc > 4 && std::strcmp(argv[4], "gro") == 0;
+      return run_recv(port, seconds, gro);
+    }
+
+    if (argc > 1 && std::strcmp(argv[1], "send") == 0) {
+      std::string host = argc > 2 ? argv[2] : "127.0.0.1";
+      int port = argc > 3 ? std::atoi(argv[3]) : 30000;
+      size_t size = argc > 4 ? std::atoi(argv[4]) : 64;
+      double seconds = argc > 5 ? std::atof(argv[5]) : 5;
+      bool gso = argc > 6 && std::strcmp(argv[6], "gso") == 0;
+      return run_send(host, port, size, seconds, gso);
+    }
+  }
+  catch (SocketException& e) {
+    std::cout << "Exception was caught:" << e.description() << "\n";
+    return 1;
+  }
+
+  usage();
+  return 1;
+}
@@ -0,0 +1,41 @@
+// Echo server on io_uring, falling back to the epoll reactor when the
+// kernel lacks the io_uring features it needs
+
+#include "ServerSocket.h"
+#include "SocketException.h"
+#include "ReactorServer.h"
+#include "UringServer.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+
+int main(int argc, const char *argv[]) {
+  // usage: uring_server [port] [epoll]
+  int port = argc > 1 ? std::atoi(argv[1]) : 30000;
+  bool force_epoll = argc > 2 && std::strcmp(argv[2], "epoll") == 0;
+
+  try {
+    ServerSocket server(port, false, SOMAXCONN);
+
+    if (!force_epoll && UringServer::available()) {
+      std::cout << "Serving with io_uring\n";
+      UringServer uring(server,
+          [](UringServer::Connection& conn, std::string_view data) {
+            conn.send(data);
+          });
+      uring.run();
+    } else {
+      std::cout << "io_uring unavailable, serving with epoll\n";
+      ReactorServer reactor(server,
+          [](ReactorServer::Connection& conn, std::string_view data) {
+            conn.send(data);
+          });
+      reactor.run();
+    }
+  }
+  catch (SocketException& e) {
+    std::cout << "Exception was caught:" << e.description() << "\nExiting\n";
+  }
+  return 0;
+}
@@ -0,0 +1,115 @@
+// Compares the sender's CPU cost of bulk transfers over a connection:
+// read()+send from a file, plain send from memory, sendfile from a file
+// and MSG_ZEROCOPY from memory.
+
+#include "ServerSocket.h"
+#include "ClientSocket.h"
+#include "SocketException.h"
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+const size_t FILE_SIZE = 16 * 1024 * 1024;
+const size_t CHUNK = 1024 * 1024;
+
+static double thread_cpu() {
+  rusage ru;
+  getrusage(RUSAGE_THREAD, &ru);
+  return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec +
+         (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+static void drain(int port, size_t total) {
+  ClientSocket c("127.0.0.1", port);
+  std::vector<char> buf(256 * 1024);
+  size_t got = 0;
+  while (got < total) {
+    ssize_t n = c.read_some(&buf[0], buf.size());
+    if (n <= 0) break;
+    got += n;
+  }
+}
+
+int main(int argc, const char *argv[]) {
+  // usage: zerocopy_bench [port] [MB]
+  int port = argc > 1 ? std::atoi(argv[1]) : 30000;
+  size_t total = (argc > 2 ? std::atoi(argv[2]) : 1024) * size_t(1024 * 1024);
+  total -= total % FILE_SIZE;
+  if (total == 0) total = FILE_SIZE;
+
+  // The file is read back from the page cache, as a busy file server's
+  // hot content would be.
+  char path[] = "/tmp/zerocopy_benchXXXXXX";
+  int fd = mkstemp(path);
+  std::string data(FILE_SIZE, 'z');
+  if (fd == -1 || write(fd, data.data(), data.size()) != (ssize_t)data.size()) {
+    std::cout << "Could not create " << path << "\n";
+    return 1;
+  }
+  unlink(path);
+
+  const char* names[] = { "read+send", "send", "sendfile", "zerocopy" };
+
+  try {
+    ServerSocket server(port);
+
+    for (int method = 0; method < 4; method++) {
+      std::thread receiver(drain, port, total);
+      ServerSocket conn = server.accept();
+
+      bool zc = method == 3 && conn.enable_zerocopy();
+      std::vector<char> chunk(CHUNK);
+
+      Clock::time_point start = Clock::now();
+      double cpu = thread_cpu();
+
+      for (size_t sent = 0; sent < total; sent += FILE_SIZE) {
+        switch (method) {
+          case 0:
+            for (size_t off = 0; off < FILE_SIZE; off += CHUNK) {
+              pread(fd, &chunk[0], CHUNK, off);
+              conn << std::string_view(&chunk[0], CHUNK);
+            }
+            break;
+          case 1:
+            conn << data;
+            break;
+          case 2:
+            conn.send_file(fd, 0, FILE_SIZE);
+            break;
+          case 3:
+            // The same buffer goes out again next round, which is safe
+            // here because it never changes.
+            conn.wait_zerocopy(conn.send_zerocopy(data));
+            break;
+        }
+      }
+
+      cpu = thread_cpu() - cpu;
+      receiver.join();
+      double secs = std::chrono::duration<double>(Clock::now() - start).count();
+      double gb = total / 1e9;
+
+      std::cout << names[method] << ": " << total / secs / 1e6 << " MB/s, sender CPU "
+                << cpu / gb * 1e3 << " ms/GB";
+      if (method == 3)
+        std::cout << (zc ? "" : " (MSG_ZEROCOPY unavailable, copied)")
+                  << (zc && conn.zerocopy_copied() ? " (kernel fell back to copying, as on loopback)" : "");
+      std::cout << "\n";
+    }
+  }
+  catch (SocketException& e) {
+    std::cout << "Exception was caught:" << e.description() << "\n";
+  }
+
+  close(fd);
+  return 0;
+}